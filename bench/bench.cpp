@@ -0,0 +1,866 @@
+/* Host Benchmarks
+ * Runs the encoder, decoder and scheduler against the simulated register
+ * backend (sim.h) and reports:
+ * 1. Encode throughput of morseEncode() and of the streaming encoder the
+ *    alarm interrupt calls, in characters per second, and whether both
+ *    skip bytes outside 7-bit ASCII
+ * 2. Decoder accuracy against timing jitter on a straight key
+ * 3. Host cost of one scheduler alarm event, and whether every edge
+ *    landed on its exact deadline
+ * 4. The same for 1, 4, 8 and 16 beacon channels, in step and at
+ *    staggered speeds, with how many channel edges each merged event
+ *    carried
+ * 5. Audio receive: keyed tone in noise at 8 and 16 kS/s through the
+ *    tone detector into the decoder, and its accuracy. The Cortex-M0+
+ *    cost of one block is a static estimate typed in from the code by
+ *    hand (audioSampleCycles), not derived from the ARM build, so it does
+ *    not follow changes to toneDetectBlock() and catches no regression.
+ *    The measured figure is INSTR_AUDIO_BLOCK, which INSTRUMENT builds
+ *    with AUDIO_RX record on the RP2040 and send in the USB status
+ * 6. Settings store on the simulated flash: random writes against a
+ *    model, several times around the sector ring with reboots in
+ *    between, and a power cut at every word of some writes, sector moves
+ *    and torn sector headers among them. Each cut must boot to the old
+ *    or the new value and take the next write
+ * 7. Host setting commands split out of a text stream
+ * 8. Whether the beep build's DORMANT check passes with the default
+ *    board's button released under its own pad pull, and not while the
+ *    button is held or settling
+ * Host speeds only compare builds with each other, they say nothing about
+ * the RP2040. Exits non-zero if clean keying or a noise-free tone no
+ * longer decodes exactly, an edge missed its deadline, a store value was
+ * lost or a command misparsed, so it can gate a release */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sim.h"
+#include "morse.h"
+#include "decoder.h"
+#include "scheduler.h"
+#include "channels.h"
+#include "toneDetect.h"
+#include "store.h"
+#include "command.h"
+#include "debounce.h"
+#include "board.h"
+
+#define BENCH_WPM 20
+#define BENCH_MIN_SECONDS 0.5
+#define BENCH_TONE_HZ 700
+#define BENCH_TONE_AMPLITUDE 64     /* Of the 8-bit sample range */
+
+static const char benchText[] =
+    "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 "
+    "CQ CQ DE TEST K PARIS PARIS 73 ";
+
+typedef std::chrono::steady_clock benchClock;
+
+static double secondsSince(benchClock::time_point start)
+{
+    return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
+/* Deterministic xorshift, the same jitter every run */
+static uint32_t randomState;
+
+static uint32_t randomNext(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/* Edit distance, counts dropped, extra and wrong characters alike */
+static size_t editDistance(const std::string &a, const std::string &b)
+{
+    std::vector<size_t> row(b.size() + 1);
+
+    for (size_t j = 0; j <= b.size(); j++) {
+        row[j] = j;
+    }
+    for (size_t i = 1; i <= a.size(); i++) {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); j++) {
+            size_t above = row[j];
+            size_t best = diagonal + (a[i - 1] != b[j - 1] ? 1 : 0);
+            if (above + 1 < best) {
+                best = above + 1;
+            }
+            if (row[j - 1] + 1 < best) {
+                best = row[j - 1] + 1;
+            }
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+/* Bytes above 7-bit ASCII are skipped, not keyed as the letter they
+ * alias: "E\xc1T" must encode exactly like "ET", in both encoders */
+static bool encodeSkipsHighBytes(void)
+{
+    static const char plain[] = "ET";
+    static const char high[] = "E\xc1T\xff";
+    uint8_t expect[32];
+    uint8_t got[32];
+    uint32_t count = morseEncode(plain, expect, sizeof expect);
+    bool ok = morseEncode(high, got, sizeof got) == count &&
+              memcmp(expect, got, count) == 0;
+
+    morseStream(high);
+    for (uint32_t i = 0; ok && i <= count; i++) {
+        ok = morseNextSymbol() == (i < count ? expect[i] : 0);
+    }
+    return ok;
+}
+
+static bool benchEncode(void)
+{
+    uint32_t length = sizeof benchText - 1;
+    static uint8_t symbols[sizeof benchText * 16];
+    uint64_t chars = 0;
+    uint32_t sink = 0;
+
+    benchClock::time_point start = benchClock::now();
+    do {
+        for (int i = 0; i < 1000; i++) {
+            sink += morseEncode(benchText, symbols, sizeof symbols);
+        }
+        chars += 1000ULL * length;
+    } while (secondsSince(start) < BENCH_MIN_SECONDS);
+    double encodeRate = chars / secondsSince(start);
+
+    chars = 0;
+    start = benchClock::now();
+    do {
+        for (int i = 0; i < 1000; i++) {
+            morseStream(benchText);
+            while (morseNextSymbol() != 0) {
+                sink++;
+            }
+        }
+        chars += 1000ULL * length;
+    } while (secondsSince(start) < BENCH_MIN_SECONDS);
+    double streamRate = chars / secondsSince(start);
+
+    printf("encode    morseEncode      %12.0f chars/s\n", encodeRate);
+    printf("encode    morseNextSymbol  %12.0f chars/s  (%u)\n", streamRate, sink & 1);
+
+    bool ok = encodeSkipsHighBytes();
+    printf("encode    bytes above 0x7f %12s\n", ok ? "skipped" : "KEYED");
+    return ok;
+}
+
+/* Key symbols into the decoder with every length off by up to
+ * +-jitterPercent of a dit, then return the decoded text */
+static std::string decodeWithJitter(const uint8_t *symbols, uint32_t count,
+                                    uint32_t ditUs, uint32_t jitterPercent)
+{
+    std::string text;
+    uint32_t now = 10 * ditUs;
+    char c;
+
+    simReset();
+    decoderInit(BENCH_WPM);
+
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t span = (int32_t)(2 * ditUs * jitterPercent / 100) + 1;
+        int32_t offset = (int32_t)(randomNext() % (uint32_t)span) - span / 2;
+        int32_t length = (int32_t)((symbols[i] & SYMBOL_UNITS_MASK) * ditUs) + offset;
+        if (length < (int32_t)ditUs / 4) {
+            length = (int32_t)ditUs / 4;
+        }
+
+        if (symbols[i] & SYMBOL_KEY_DOWN) {
+            simSetTime(now);
+            decoderEdge(now, true);
+            decoderPoll();
+            now += (uint32_t)length;
+            simSetTime(now);
+            decoderEdge(now, false);
+            decoderPoll();
+        } else {
+            now += (uint32_t)length;
+        }
+        while (decoderGetChar(&c)) {
+            text += c;
+        }
+    }
+
+    /* Let the final word gap pass */
+    simSetTime(now + 10 * ditUs);
+    decoderPoll();
+    while (decoderGetChar(&c)) {
+        text += c;
+    }
+    return text;
+}
+
+static bool benchDecode(void)
+{
+    static const uint32_t jitters[] = { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+    static uint8_t symbols[sizeof benchText * 16];
+    uint32_t count = morseEncode(benchText, symbols, sizeof symbols);
+    uint32_t ditUs = morseDitUs(BENCH_WPM);
+    std::string expected(benchText);
+    bool clean = true;
+
+    randomState = 0x2545f491;
+    for (uint32_t j = 0; j < sizeof jitters / sizeof jitters[0]; j++) {
+        std::string decoded = decodeWithJitter(symbols, count, ditUs, jitters[j]);
+        size_t errors = editDistance(expected, decoded);
+        double accuracy = 100.0 * (1.0 - (double)errors / expected.size());
+        if (accuracy < 0) {
+            accuracy = 0;
+        }
+        printf("decode    jitter +-%3u%%    %11.1f %%  (%zu errors)\n",
+               jitters[j], accuracy, errors);
+        if (jitters[j] == 0 && errors != 0) {
+            printf("decode    FAIL: clean keying gave \"%s\"\n", decoded.c_str());
+            clean = false;
+        }
+    }
+    return clean;
+}
+
+/* Edge times seen by the key hook, in simulated microseconds */
+static std::vector<uint32_t> edgeTimes;
+
+static void recordEdge(bool down)
+{
+    (void)down;
+    edgeTimes.push_back((uint32_t)timer->timerawl);
+}
+
+static bool benchScheduler(void)
+{
+    static uint8_t symbols[sizeof benchText * 16];
+    uint32_t count = morseEncode(benchText, symbols, sizeof symbols);
+    uint32_t ditUs = morseDitUs(BENCH_WPM);
+    uint64_t events = 0;
+    uint32_t worstUs = 0;
+    double seconds = 0;
+
+    /* Timed runs, the clock only runs around the alarm handler */
+    do {
+        simReset();
+        schedulerInit(1U << 25, ditUs);
+        edgeTimes.clear();
+        schedulerSetKeyHook(recordEdge);
+        morseSend(benchText);
+
+        benchClock::time_point start = benchClock::now();
+        while (simRunAlarm(0, timerIrq0)) {
+            events++;
+        }
+        seconds += secondsSince(start);
+    } while (seconds < BENCH_MIN_SECONDS);
+
+    /* The last run's edges against the encoder's own timeline: one edge
+       per symbol, one closing key up, no drift */
+    uint32_t ideal = 0;
+    bool exact = edgeTimes.size() == count + 1;
+    for (uint32_t i = 0; exact && i <= count; i++) {
+        uint32_t error = edgeTimes[i] > ideal ? edgeTimes[i] - ideal : ideal - edgeTimes[i];
+        if (error > worstUs) {
+            worstUs = error;
+        }
+        if (i < count) {
+            ideal += (symbols[i] & SYMBOL_UNITS_MASK) * ditUs;
+        }
+    }
+    exact = exact && worstUs == 0;
+
+    printf("scheduler alarm event      %12.1f ns/event\n", seconds * 1e9 / events);
+    printf("scheduler edges            %12zu  worst error %u us\n", edgeTimes.size(), worstUs);
+    if (!exact) {
+        printf("scheduler FAIL: %zu edges for %u symbols\n", edgeTimes.size(), count);
+    }
+    return exact;
+}
+
+/* Channel counts benched, CHANNELS_MAX of the bench build is the last */
+static const uint32_t benchChannelCounts[] = { 1, 4, 8, 16 };
+
+typedef char benchChannelsFit[(CHANNELS_MAX >= 16) ? 1 : -1];
+
+/* Every channel keys one SIO bit, a channel's edge is its bit showing up
+ * in the clear or set store of an event. In step all channels share one
+ * dit and many edges merge into one event, staggered every channel is
+ * 1% slower than the one before and most events carry one edge */
+static bool benchChannelsRun(uint32_t channels, bool staggered)
+{
+    static uint8_t symbols[CHANNELS_MAX][sizeof benchText * 16];
+    static uint32_t count[CHANNELS_MAX];
+    static std::vector<uint32_t> times[CHANNELS_MAX];
+    std::vector<std::pair<uint32_t, uint32_t> > keyed;     /* Time, keyed bits */
+    uint32_t ditUs[CHANNELS_MAX];
+    uint64_t events = 0;
+    uint64_t edges = 0;
+    uint32_t worstUs = 0;
+    double seconds = 0;
+    bool exact = true;
+
+    for (uint32_t k = 0; k < channels; k++) {
+        ditUs[k] = morseDitUs(BENCH_WPM) * (staggered ? 100 + k : 100) / 100;
+    }
+
+    /* Same text rotated per channel, so lengths and edges differ */
+    for (uint32_t k = 0; k < channels; k++) {
+        std::string text(benchText + k * 4);
+        text += std::string(benchText, k * 4);
+        count[k] = morseEncode(text.c_str(), symbols[k], sizeof symbols[k]);
+    }
+
+    do {
+        simReset();
+        channelsInit();
+        for (uint32_t k = 0; k < channels; k++) {
+            channelsConfigure(k, 1U << k, ditUs[k]);
+            channelsLoad(k, symbols[k], count[k], false);
+        }
+        keyed.clear();
+        keyed.reserve(sizeof symbols[0] * channels);
+
+        /* Only the event and the store of its bits are timed, the split
+         * into channels comes after */
+        benchClock::time_point start = benchClock::now();
+        channelsStart((uint32_t)((1ULL << channels) - 1));
+        do {
+            keyed.push_back(std::make_pair((uint32_t)timer->timerawl,
+                                           simSio.gpio_out_set | simSio.gpio_out_clr));
+            simSio.gpio_out_set = 0;
+            simSio.gpio_out_clr = 0;
+        } while (simRunAlarm(3, timerIrq3));
+        seconds += secondsSince(start);
+        events += keyed.size();
+    } while (seconds < BENCH_MIN_SECONDS);
+
+    /* Edges of the last run */
+    for (uint32_t k = 0; k < channels; k++) {
+        times[k].clear();
+    }
+    for (size_t e = 0; e < keyed.size(); e++) {
+        for (uint32_t k = 0; k < channels; k++) {
+            if (keyed[e].second & (1U << k)) {
+                times[k].push_back(keyed[e].first);
+                edges++;
+            }
+        }
+    }
+
+    for (uint32_t k = 0; k < channels; k++) {
+        uint32_t ideal = 0;
+        if (times[k].size() != count[k] + 1) {
+            printf("channels  FAIL: channel %u keyed %zu edges for %u symbols\n",
+                   k, times[k].size(), count[k]);
+            exact = false;
+            continue;
+        }
+        for (uint32_t i = 0; i <= count[k]; i++) {
+            uint32_t error = times[k][i] > ideal ? times[k][i] - ideal : ideal - times[k][i];
+            if (error > worstUs) {
+                worstUs = error;
+            }
+            if (i < count[k]) {
+                ideal += (symbols[k][i] & SYMBOL_UNITS_MASK) * ditUs[k];
+            }
+        }
+    }
+    exact = exact && worstUs == 0;
+
+    double perEvent = seconds * 1e9 / events;
+    double edgesPerEvent = (double)edges / keyed.size();
+    printf("channels  %2u %-9s      %12.1f ns/event  %.2f edges/event  %.1f ns/edge  worst error %u us\n",
+           channels, staggered ? "staggered" : "in step", perEvent, edgesPerEvent,
+           perEvent / edgesPerEvent, worstUs);
+    return exact;
+}
+
+static bool benchChannels(void)
+{
+    bool ok = true;
+
+    for (uint32_t n : benchChannelCounts) {
+        ok = benchChannelsRun(n, false) && ok;
+    }
+    for (uint32_t n : benchChannelCounts) {
+        ok = benchChannelsRun(n, true) && ok;
+    }
+    return ok;
+}
+
+/* 8-bit samples of symbols keyed as a tone at sampleHz, with uniform
+ * noise of +-noise on top. Leading and trailing silence lets the
+ * detector settle and the last word finish */
+static std::vector<uint8_t> keyedAudio(const uint8_t *symbols, uint32_t count,
+                                       uint32_t sampleHz, uint32_t noise)
+{
+    std::vector<uint8_t> samples;
+    uint32_t ditSamples = (uint32_t)((uint64_t)morseDitUs(BENCH_WPM) * sampleHz / 1000000);
+    double step = 2.0 * M_PI * BENCH_TONE_HZ / sampleHz;
+    uint64_t n = 0;
+
+    for (uint32_t i = 0; i <= count + 1; i++) {
+        bool down = i > 0 && i <= count && (symbols[i - 1] & SYMBOL_KEY_DOWN);
+        uint32_t length = (i > 0 && i <= count) ? (symbols[i - 1] & SYMBOL_UNITS_MASK) * ditSamples
+                                                : 10 * ditSamples;
+        for (uint32_t k = 0; k < length; k++, n++) {
+            int32_t x = 128;
+            if (down) {
+                x += (int32_t)lround(BENCH_TONE_AMPLITUDE * sin(step * (double)n));
+            }
+            if (noise != 0) {
+                x += (int32_t)(randomNext() % (2 * noise + 1)) - (int32_t)noise;
+            }
+            samples.push_back((uint8_t)(x < 0 ? 0 : x > 255 ? 255 : x));
+        }
+    }
+    samples.resize(samples.size() - samples.size() % TONE_DETECT_BLOCK);
+    return samples;
+}
+
+/* Run samples block by block through the detector into the decoder, key
+ * edges timed at the end of their block */
+static std::string decodeAudio(const std::vector<uint8_t> &samples, uint32_t sampleHz)
+{
+    std::string text;
+    bool down = false;
+    char c;
+
+    simReset();
+    decoderInit(BENCH_WPM);
+    toneDetectInit(BENCH_TONE_HZ, sampleHz);
+
+    for (size_t block = 0; block < samples.size() / TONE_DETECT_BLOCK; block++) {
+        uint32_t now = (uint32_t)((block + 1) * TONE_DETECT_BLOCK * 1000000ULL / sampleHz);
+        simSetTime(now);
+        if (toneDetectBlock(&samples[block * TONE_DETECT_BLOCK]) != down) {
+            down = !down;
+            decoderEdge(now, down);
+        }
+        decoderPoll();
+        while (decoderGetChar(&c)) {
+            text += c;
+        }
+    }
+    return text;
+}
+
+/* Static estimate of one audio block in dmaIrq1 on the Cortex-M0+
+ * Counted by hand from the instructions the code should need: dmaIrq1
+ * and toneDetectBlock run from SRAM without wait states, a load takes 2
+ * cycles, a taken branch 2 and the single-cycle multiplier 1. Nothing
+ * here is read from the compiled code, so it stays the same whatever
+ * toneDetectBlock() turns into. Keep it in step with the code by hand
+ * and trust INSTR_AUDIO_BLOCK over it */
+struct cycleCost {
+    const char *what;
+    uint32_t cycles;
+};
+
+/* Once per sample, the Goertzel loop */
+static const cycleCost audioSampleCycles[] = {
+    { "ldrb sample", 2 },
+    { "add to the block sum", 1 },
+    { "subtract the bias", 1 },
+    { "mov + muls coeff * s1", 2 },
+    { "asrs back to Q12", 1 },
+    { "add, subtract s2", 2 },
+    { "move s1 to s2, s to s1", 2 },
+    { "nine live values in eight low registers", 2 },
+    { "adds, cmp, bne", 4 },
+};
+
+/* Once per block */
+static const cycleCost audioBlockCycles[] = {
+    { "exception entry and return", 28 },
+    { "dmaIrq1: status, acknowledge, re-arm write_addr", 24 },
+    { "toneDetectBlock call, push, pop", 12 },
+    { "new bias, magnitude with two muls", 30 },
+    { "peak, floor, squelch and hysteresis", 36 },
+    { "key change check", 8 },
+};
+
+static uint32_t cycleSum(const cycleCost *costs, size_t count)
+{
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += costs[i].cycles;
+    }
+    return sum;
+}
+
+static bool benchAudio(void)
+{
+    static const uint32_t rates[] = { 8000, 16000 };
+    static const uint32_t noises[] = { 0, 16, 32, 48, 64 };
+    static uint8_t symbols[sizeof benchText * 16];
+    uint32_t count = morseEncode(benchText, symbols, sizeof symbols);
+    std::string expected(benchText);
+    bool clean = true;
+
+    randomState = 0x2545f491;
+    for (uint32_t r = 0; r < sizeof rates / sizeof rates[0]; r++) {
+        uint32_t sampleHz = rates[r];
+
+        for (uint32_t j = 0; j < sizeof noises / sizeof noises[0]; j++) {
+            std::vector<uint8_t> samples = keyedAudio(symbols, count, sampleHz, noises[j]);
+            std::string decoded = decodeAudio(samples, sampleHz);
+            size_t errors = editDistance(expected, decoded);
+            double accuracy = 100.0 * (1.0 - (double)errors / expected.size());
+            if (accuracy < 0) {
+                accuracy = 0;
+            }
+            printf("audio     %5u S/s noise %2u %8.1f %%  (%zu errors)\n",
+                   sampleHz, noises[j], accuracy, errors);
+            if (noises[j] == 0 && errors != 0) {
+                printf("audio     FAIL: clean tone gave \"%s\"\n", decoded.c_str());
+                clean = false;
+            }
+        }
+
+        /* Detector alone over the noisiest signal, host cost */
+        std::vector<uint8_t> samples = keyedAudio(symbols, count, sampleHz,
+                                                  noises[sizeof noises / sizeof noises[0] - 1]);
+        size_t blocks = samples.size() / TONE_DETECT_BLOCK;
+        uint64_t runs = 0;
+        uint32_t sink = 0;
+        toneDetectInit(BENCH_TONE_HZ, sampleHz);
+        benchClock::time_point start = benchClock::now();
+        do {
+            for (size_t block = 0; block < blocks; block++) {
+                sink += toneDetectBlock(&samples[block * TONE_DETECT_BLOCK]) ? 1 : 0;
+            }
+            runs += blocks;
+        } while (secondsSince(start) < BENCH_MIN_SECONDS);
+        double blockNs = secondsSince(start) * 1e9 / runs;
+
+        printf("audio     %5u S/s  %12.1f ns/block on the host  (%u)\n",
+               sampleHz, blockNs, sink & 1);
+    }
+
+    /* Estimated target cost, against the block period */
+    uint32_t perSample = cycleSum(audioSampleCycles, sizeof audioSampleCycles / sizeof audioSampleCycles[0]);
+    uint32_t perBlock = TONE_DETECT_BLOCK * perSample +
+                        cycleSum(audioBlockCycles, sizeof audioBlockCycles / sizeof audioBlockCycles[0]);
+    static const uint32_t clocksMhz[] = { 125, 133 };    /* Profiles that run clk_adc */
+
+    printf("audio     static estimate %10u cycles/block  (%u per sample, not measured)\n",
+           perBlock, perSample);
+    for (uint32_t r = 0; r < sizeof rates / sizeof rates[0]; r++) {
+        for (uint32_t c = 0; c < sizeof clocksMhz / sizeof clocksMhz[0]; c++) {
+            double periodCycles = (double)TONE_DETECT_BLOCK * clocksMhz[c] * 1e6 / rates[r];
+            printf("audio     %5u S/s %3u MHz  estimated headroom %6.1fx  (%.2f %% load)\n",
+                   rates[r], clocksMhz[c], periodCycles / perBlock, 100.0 * perBlock / periodCycles);
+        }
+    }
+    return clean;
+}
+
+/* Settings store, checked against a model of what it should hold */
+#define STORE_BENCH_KEYS 8          /* Live values stay well within a sector */
+#define STORE_BENCH_WRITES 4000
+#define STORE_BENCH_REBOOT 97       /* Boot again after this many writes */
+#define STORE_BENCH_SWEEPS 4        /* Writes of each kind cut at every word */
+#define STORE_BENCH_SECTOR 4096U
+#define STORE_BENCH_MAGIC 0x53565354U   /* Sector header of store.c */
+
+static std::string storeModel[STORE_KEYS];
+
+static bool storeMatches(const std::string *model)
+{
+    for (uint32_t key = 0; key < STORE_KEYS; key++) {
+        uint32_t length = 0;
+        const uint8_t *value = (const uint8_t *)storeGet(key, &length);
+        bool same = model[key].empty() ? value == 0
+                                       : value != 0 && length == model[key].size() &&
+                                         memcmp(value, model[key].data(), length) == 0;
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string storeRandomValue(void)
+{
+    uint32_t length = (randomNext() & 15) == 0 ? 0 : 1 + randomNext() % 120;
+    std::string value;
+
+    for (uint32_t i = 0; i < length; i++) {
+        value += (char)randomNext();
+    }
+    return value;
+}
+
+/* A sector header the write left half programmed: not erased, not valid */
+static bool storeTornHeader(void)
+{
+    const uint8_t *region = simFlash + SIM_FLASH_BYTES - SIM_STORE_BYTES;
+
+    for (uint32_t at = 0; at < SIM_STORE_BYTES; at += STORE_BENCH_SECTOR) {
+        uint32_t header[4];
+        memcpy(header, region + at, sizeof header);
+        bool erased = (header[0] & header[1] & header[2] & header[3]) == 0xffffffffU;
+        bool valid = header[0] == STORE_BENCH_MAGIC && header[2] == ~header[1];
+        if (!erased && !valid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct storeCuts {
+    uint32_t moves;         /* Writes swept that moved to the next sector */
+    uint32_t appends;       /* Writes swept that appended in place */
+    uint32_t cuts;
+    uint32_t kept;          /* Cuts that booted to the old value */
+    uint32_t torn;          /* Cuts that left a torn sector header */
+};
+
+/* Write key, and unless enough writes of its kind were swept, replay it
+ * from the flash image before it with the power cut after every word
+ * programmed. Each cut must boot to the old or the new value, the old
+ * one with a torn header, and take another write */
+static bool storeWrite(uint32_t key, const std::string &value, storeCuts *sweep)
+{
+    static uint8_t before[SIM_FLASH_BYTES];
+    static uint8_t after[SIM_FLASH_BYTES];
+    uint32_t erases = simFlashErases;
+    uint32_t programmed = simFlashProgrammed;
+
+    memcpy(before, simFlash, sizeof before);
+    if (!storePut(key, value.data(), value.size())) {
+        return false;
+    }
+    uint32_t total = simFlashProgrammed - programmed;
+    bool moved = simFlashErases != erases;
+    uint32_t *swept = moved ? &sweep->moves : &sweep->appends;
+    if (*swept >= STORE_BENCH_SWEEPS) {
+        return true;
+    }
+    (*swept)++;
+    memcpy(after, simFlash, sizeof after);
+
+    bool ok = true;
+    uint32_t other = (key + 1) % STORE_BENCH_KEYS;
+    for (uint32_t cut = 0; ok && cut < total; cut += 4) {
+        memcpy(simFlash, before, sizeof before);
+        storeInit();
+        simFlashBudget = (int32_t)cut;
+        storePut(key, value.data(), value.size());
+        simFlashBudget = -1;
+        bool torn = storeTornHeader();
+
+        storeInit();
+        std::string expect[STORE_KEYS];
+        for (uint32_t k = 0; k < STORE_KEYS; k++) {
+            expect[k] = storeModel[k];
+        }
+        bool old = storeMatches(expect);
+        expect[key] = value;
+        if (old) {
+            expect[key] = storeModel[key];
+        }
+        ok = (old || storeMatches(expect)) && (!torn || old);
+
+        expect[other] = "73";
+        ok = ok && storePut(other, "73", 2);
+        storeInit();
+        ok = ok && storeMatches(expect);
+
+        sweep->cuts++;
+        sweep->kept += old ? 1 : 0;
+        sweep->torn += torn ? 1 : 0;
+    }
+
+    memcpy(simFlash, after, sizeof after);
+    storeInit();
+    simFlashErases = erases + (moved ? 1 : 0);     /* The replays did not happen */
+    simFlashProgrammed = programmed + total;
+    return ok;
+}
+
+static bool benchStore(void)
+{
+    storeCuts sweep = {};
+    bool ok = true;
+    uint32_t writes = 0;
+
+    randomState = 0x6b8b4567;
+    simFlashErase();
+    storeInit();
+    for (uint32_t k = 0; k < STORE_KEYS; k++) {
+        storeModel[k].clear();
+    }
+
+    for (; ok && writes < STORE_BENCH_WRITES; writes++) {
+        uint32_t key = randomNext() % STORE_BENCH_KEYS;
+        std::string value = storeRandomValue();
+
+        ok = storeWrite(key, value, &sweep);
+        storeModel[key] = value;
+        ok = ok && storeMatches(storeModel);
+        if (writes % STORE_BENCH_REBOOT == STORE_BENCH_REBOOT - 1) {
+            storeInit();
+            ok = ok && storeMatches(storeModel);
+        }
+    }
+    storeInit();
+    ok = ok && storeMatches(storeModel);
+
+    uint32_t trips = simFlashErases / (SIM_STORE_BYTES / STORE_BENCH_SECTOR);
+    ok = ok && trips >= 2 && sweep.moves == STORE_BENCH_SWEEPS && sweep.torn != 0;
+
+    printf("store     %5u writes     %12u erases  %u trips around the ring\n",
+           writes, simFlashErases, trips);
+    printf("store     %5u power cuts %12u kept the old value  %u torn headers\n",
+           sweep.cuts, sweep.kept, sweep.torn);
+    if (!ok) {
+        printf("store     FAIL: a value was lost or a write refused after %u writes\n", writes);
+    }
+    return ok;
+}
+
+/* Setting commands among host text */
+static const char *commandInput;
+
+static bool commandInputChar(char *c)
+{
+    if (*commandInput == 0) {
+        return false;
+    }
+    *c = *commandInput++;
+    return true;
+}
+
+static bool benchCommand(void)
+{
+    struct expected {
+        enum commandId id;
+        uint32_t value;
+        const char *text;
+    };
+    static const char input[] =
+        "CQ\r\n"
+        "\\WPM 25\r\n"
+        "DE\r\n"
+        "\\beacon b HELLO  WORLD\r\n"
+        "\\TONE 7x\r\n"
+        "\\BEACON C\r\n"
+        "\\FOO 1\r"
+        "\\BEACON A 0123456789012345678901234567890123456789012345678901234567\r"
+        "K \\WPM 9\r";
+    static const expected commands[] = {
+        { COMMAND_WPM, 25, "" },
+        { COMMAND_BEACON, 1, "HELLO  WORLD" },
+        { COMMAND_INVALID, 0, "" },
+        { COMMAND_BEACON, 2, "" },
+        { COMMAND_INVALID, 0, "" },
+        { COMMAND_INVALID, 0, "" },     /* Longer than COMMAND_LINE_MAX */
+    };
+    const size_t count = sizeof commands / sizeof commands[0];
+    std::string keyed;
+    size_t taken = 0;
+    bool ok = true;
+    struct command command;
+    char c;
+
+    commandInput = input;
+    commandSource(commandInputChar);
+    while (true) {
+        while (commandNextChar(&c)) {
+            keyed += c;
+        }
+        if (!commandTake(&command)) {
+            break;
+        }
+        if (taken < count) {
+            const expected *e = &commands[taken];
+            ok = ok && command.id == e->id && command.value == e->value &&
+                 command.length == strlen(e->text) && strcmp(command.text, e->text) == 0;
+        }
+        taken++;
+    }
+    ok = ok && taken == count && keyed == "CQ\r\n\nDE\r\n\n\n\nK \\WPM 9\r";
+
+    printf("command   %5zu commands   %12s\n", taken, ok ? "as sent" : "MISPARSED");
+    return ok;
+}
+
+/* Button edges of the DORMANT case, counted only */
+static uint32_t buttonEdges;
+
+static void countEdge(uint32_t timestampUs, bool down)
+{
+    (void)timestampUs;
+    (void)down;
+    buttonEdges++;
+}
+
+/* keyerIdle() of the beep build in transmitter.cpp */
+static bool dormantReady(void)
+{
+    return schedulerIdle() && !morseBusy() && debounceIdle();
+}
+
+/* Press the button by driving its pin, raise its edge interrupt */
+static void buttonDrive(bool pressed)
+{
+    simSetInputs(1U << BUTTON_PIN, pressed != (BUTTON_ACTIVE_LOW != 0) ? 1U << BUTTON_PIN : 0);
+    simIo.proc0_ints[BUTTON_PIN / 8] = 0xfU << (4 * (BUTTON_PIN % 8));
+    debounceIrq();
+    simIo.proc0_ints[BUTTON_PIN / 8] = 0;
+}
+
+static bool benchDormant(void)
+{
+    simReset();
+    simPads.gpio[BUTTON_PIN] = BUTTON_PAD;
+    simSetInputs(0, 0);
+    schedulerInit(1U << LED_PIN, morseDitUs(BENCH_WPM));
+    debounceInit();
+    debounceAdd(BUTTON_PIN, DEBOUNCE_MECHANICAL_US, BUTTON_ACTIVE_LOW != 0, countEdge);
+
+    /* Released under the pad pull alone */
+    bool released = dormantReady();
+
+    /* Pressed and held, then let go: awake until the release settles */
+    buttonDrive(true);
+    bool awakeBouncing = !dormantReady();
+    while (simRunAlarm(2, timerIrq2)) {}
+    bool awakeHeld = !dormantReady();
+    buttonDrive(false);
+    bool awakeSettling = !dormantReady();
+    while (simRunAlarm(2, timerIrq2)) {}
+    bool again = dormantReady() && buttonEdges == 2;
+
+    bool ok = released && awakeBouncing && awakeHeld && awakeSettling && again;
+    printf("power     dormant %12s with the button released, %s while held\n",
+           released && again ? "entered" : "NOT ENTERED", awakeBouncing && awakeHeld && awakeSettling ? "awake" : "ASLEEP");
+    return ok;
+}
+
+int main(void)
+{
+    bool ok = benchEncode();
+    ok = benchDecode() && ok;
+    ok = benchScheduler() && ok;
+    ok = benchChannels() && ok;
+    ok = benchAudio() && ok;
+    ok = benchStore() && ok;
+    ok = benchCommand() && ok;
+    ok = benchDormant() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/* Simulated Register Backend */
+
+#include <string.h>
+
+#include "sim.h"
+
+extern "C" {
+volatile struct sio_hw simSio;
+volatile struct io_bank0_hw simIo;
+volatile struct pads_bank0_hw simPads;
+volatile struct timer_hw simTimer;
+volatile uint32_t simResets[3];
+volatile uint32_t simNvic[3];
+uint32_t simPrimask;
+uint8_t simFlash[SIM_FLASH_BYTES];
+uint32_t simFlashErases;
+uint32_t simFlashProgrammed;
+int32_t simFlashBudget = -1;
+}
+
+/* Last value each alarm fired at, an alarm holding it is disarmed */
+static uint32_t firedAt[4];
+
+void simReset(void)
+{
+    memset((void *)&simSio, 0, sizeof simSio);
+    memset((void *)&simIo, 0, sizeof simIo);
+    memset((void *)&simPads, 0, sizeof simPads);
+    memset((void *)&simTimer, 0, sizeof simTimer);
+    simResets[0] = 0;
+    simResets[1] = 0;
+    simResets[2] = 0xffffffffU;
+    simNvic[0] = 0;
+    simNvic[1] = 0;
+    simNvic[2] = 0;
+    simPrimask = 0;
+    memset(firedAt, 0, sizeof firedAt);
+}
+
+void simSetInputs(uint32_t mask, uint32_t levels)
+{
+    uint32_t pulled = 0;
+
+    for (uint32_t pin = 0; pin < 30; pin++) {
+        if ((simPads.gpio[pin] & PADS_GPIO_PUE) != 0) {
+            pulled |= 1U << pin;
+        }
+    }
+    simSio.gpio_in = (pulled & ~mask) | (levels & mask);
+}
+
+void simSetTime(uint32_t us)
+{
+    simTimer.timerawl = us;
+    simTimer.timelr = us;
+}
+
+bool simRunAlarm(uint32_t alarm, void (*handler)(void))
+{
+    uint32_t bit = 1U << alarm;
+
+    if ((simTimer.inte & bit) == 0) {
+        return false;
+    }
+    if ((simTimer.intf & bit) == 0) {
+        uint32_t deadline = simTimer.alarm[alarm];
+        if (deadline == firedAt[alarm] || (int32_t)(deadline - simTimer.timerawl) < 0) {
+            return false;
+        }
+        simSetTime(deadline);
+    }
+
+    firedAt[alarm] = simTimer.alarm[alarm];
+    simTimer.intr |= bit;
+    handler();
+    return true;
+}
+
+/* Bootrom flash routines, offsets count from the start of simFlash */
+static void flashNothing(void)
+{
+}
+
+static void flashErase(uint32_t offset, uint32_t count, uint32_t blockSize, uint8_t blockCmd)
+{
+    (void)blockSize;
+    (void)blockCmd;
+    if (simFlashBudget != 0 && offset + count <= SIM_FLASH_BYTES) {
+        memset(simFlash + offset, 0xff, count);
+        simFlashErases++;
+    }
+}
+
+static void flashProgram(uint32_t offset, const uint8_t *data, uint32_t count)
+{
+    if (offset + count > SIM_FLASH_BYTES) {
+        return;
+    }
+    if (simFlashBudget >= 0 && count > (uint32_t)simFlashBudget) {
+        count = (uint32_t)simFlashBudget;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        simFlash[offset + i] &= data[i];
+    }
+    simFlashProgrammed += count;
+    if (simFlashBudget >= 0) {
+        simFlashBudget -= (int32_t)count;
+    }
+}
+
+void *simRomFuncLookup(uint32_t code)
+{
+    switch (code) {
+    case ROM_FLASH_ERASE:
+        return (void *)flashErase;
+    case ROM_FLASH_PROGRAM:
+        return (void *)flashProgram;
+    default:
+        return (void *)flashNothing;
+    }
+}
+
+void simFlashErase(void)
+{
+    memset(simFlash, 0xff, sizeof simFlash);
+}
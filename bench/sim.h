@@ -0,0 +1,62 @@
+/* Simulated Register Backend
+ * Plain memory behind the HOST_SIM register pointers in rp2040.h, plus
+ * just enough TIMER behaviour to run alarm handlers in simulated time:
+ * an alarm counts as armed once its register holds a value that has not
+ * fired yet, and firing moves the clock to that value first. Forced
+ * interrupts (intf) fire at the current time.
+ *
+ * Flash is an image in host memory (simFlash, rp2040.h) that the bootrom
+ * routines of romFuncLookup() erase and program like the chip: erasing
+ * sets bytes to 0xff, programming can only clear bits. A budget of bytes
+ * stops programming part way, as a power cut would */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Alarm handlers of the firmware modules */
+void timerIrq0(void);
+void timerIrq1(void);
+void timerIrq2(void);
+void timerIrq3(void);
+
+/* Zero every register, release all blocks from reset and start the
+ * clock at 0 */
+void simReset(void);
+
+/* GPIO inputs: pins in mask read their bit of levels, every other pin
+ * reads what its pad pulls it to, high with PUE and low otherwise */
+void simSetInputs(uint32_t mask, uint32_t levels);
+
+/* Move the clock to us, which must not be in the past */
+void simSetTime(uint32_t us);
+
+/* Run handler for the next firing of alarm, returns false if it is not
+ * enabled or not armed */
+bool simRunAlarm(uint32_t alarm, void (*handler)(void));
+
+/* Sectors erased and bytes programmed in simFlash so far */
+extern uint32_t simFlashErases;
+extern uint32_t simFlashProgrammed;
+
+/* Bytes that may still be programmed, negative for no limit. Once it is
+ * used up a program stops short and later erases and programs do
+ * nothing, until the budget is set again */
+extern int32_t simFlashBudget;
+
+/* Erase the whole image */
+void simFlashErase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
@@ -0,0 +1,32 @@
+/* Keyer Board Rev B
+ * Pico on the keyer carrier board: the button closes to ground on GPIO20,
+ * the speaker driver sits on GPIO18 and a panel LED on GPIO19. The
+ * paddle jack moved to GPIO10/11 and UART0 to GPIO12/13 with RTS on
+ * GPIO15, leaving GPIO 2-9 for beacon channels. The receiver audio
+ * jack feeds ADC2 on GPIO28. The panel button is a sealed tactile
+ * switch that settles faster than the Pico's */
+
+#ifndef BOARD_KEYER_REVB_H
+#define BOARD_KEYER_REVB_H
+
+#define BUTTON_PIN 20           /* Push button input */
+#define BUTTON_ACTIVE_LOW 1     /* Closes to ground, pulled up */
+#define BUTTON_PAD_EXTRA PADS_GPIO_SCHMITT
+#define SPEAKER_PIN 18          /* Speaker driver, PWM slice 1 A */
+#define LED_PIN 19              /* Panel LED */
+
+#define IAMBIC_DIT_PIN 10       /* Dit paddle, closes to ground */
+#define IAMBIC_DAH_PIN 11       /* Dah paddle, closes to ground */
+
+#define UART_TX_PIN 12
+#define UART_RX_PIN 13
+#define UART_RTS_PIN 15
+
+#define BEACON_FIRST_PIN 2
+#define BEACON_MAX_CHANNELS 8   /* Up to the paddle pins */
+
+#define AUDIO_PIN 28            /* Receiver audio, ADC2 */
+
+#define BUTTON_DEBOUNCE_US 2000
+
+#endif /* BOARD_KEYER_REVB_H */
@@ -0,0 +1,27 @@
+/* Raspberry Pi Pico
+ * The original wiring: push button to 3V3 on GPIO16, speaker on GPIO21,
+ * the onboard LED on GPIO25, paddles on GPIO14/15 and UART0 on GPIO0/1
+ * with RTS on GPIO3. GPIO 4-13 are free for beacon channels, receiver
+ * audio goes to ADC0 on GPIO26 */
+
+#ifndef BOARD_PICO_H
+#define BOARD_PICO_H
+
+#define BUTTON_PIN 16           /* Push button input */
+#define BUTTON_ACTIVE_LOW 0     /* Reads high while pressed, pulled down */
+#define SPEAKER_PIN 21          /* Speaker output */
+#define LED_PIN 25              /* Onboard LED */
+
+#define IAMBIC_DIT_PIN 14       /* Dit paddle, closes to ground */
+#define IAMBIC_DAH_PIN 15       /* Dah paddle, closes to ground */
+
+#define UART_TX_PIN 0
+#define UART_RX_PIN 1
+#define UART_RTS_PIN 3
+
+#define BEACON_FIRST_PIN 4
+#define BEACON_MAX_CHANNELS 10  /* Up to the paddle pins */
+
+#define AUDIO_PIN 26            /* Receiver audio, ADC0 */
+
+#endif /* BOARD_PICO_H */
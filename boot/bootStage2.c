@@ -5,6 +5,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* SSI clock divider, clk_sys / BOOT2_CLKDIV drives SCLK
+ * Must be even, override from the Makefile with BOOT2_CLKDIV= */
+#ifndef BOOT2_CLKDIV
+#define BOOT2_CLKDIV 4
+#endif
+
 /* Hardware Register Definitions */
 
 /* Base address for XIP (Execute In Place) peripheral */
@@ -30,9 +36,15 @@
  * 3. Enable XIP Cache */
 
 /* Boot stage 2 entry point
- * This function is placed in .boot2 section by the linker */
+ * This function is placed in .boot2 section by the linker. The code is
+ * position independent, so a copy in SRAM can also be called as a plain
+ * function: it then sets up the SSI and returns */
 __attribute__((section(".boot2"))) void bootStage2(void)
 {
+    // 0. The bootrom enters with lr = 0, the flash store (src/store.c)
+    //    calls a copy in SRAM to restore XIP after erase or program
+    uint32_t caller = (uint32_t)__builtin_return_address(0);
+
     // 1. Setup IO_QSPI pins for XIP (already done by bootrom)
     //  - Bring IO_QSPI out of reset state
     //  - Set SCLK and SS to OE
@@ -41,7 +53,7 @@ __attribute__((section(".boot2"))) void bootStage2(void)
     // 2. Setup SSI interface
     //  - Read 2 byte status register
     SSI_SSIENR = 0; // Disable SSI to configure it
-    SSI_BAUDR = 4; // Set clock divider to 4
+    SSI_BAUDR = BOOT2_CLKDIV; // Set clock divider
     SSI_CTRLR0 = (7 << 16); // Set 8 clocks per data frame
     SSI_SSIENR = 1; // Enable SSI
     SSI_DR0 = 0x05; // Read Status Register 1
@@ -67,6 +79,11 @@ __attribute__((section(".boot2"))) void bootStage2(void)
     // 3. Enable XIP Cache
     // It is enabled by default. Take a look at https://datasheets.raspberrypi.com/rp2040/rp2040-datasheet.pdf#page=128
 
+    // Called as a function, only XIP had to be set up again
+    if (caller != 0) {
+        return;
+    }
+
     // Mimic non-rp2040 Arm microcontroller behavior
     // 1. Set correct VTOR value
     M0PLUS_VTOR = XIP_BASE + 0x100; // Start of flash + boot stage 2 size
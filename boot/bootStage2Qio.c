@@ -0,0 +1,132 @@
+/* Second Stage Bootloader for the RP2040, Quad I/O continuous read variant
+ * Responsible for initializing flash XIP (Execute In Place) mode
+ * Sets up SSI interface for Fast Read Quad I/O (EBh) in continuous read
+ * mode, so after the first access every XIP cache miss sends only the
+ * address and mode bits on four lines, with no 8-bit serial command */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* SSI clock divider, clk_sys / BOOT2_CLKDIV drives SCLK
+ * Must be even, 2 is only safe on boards whose flash is rated for it */
+#ifndef BOOT2_CLKDIV
+#define BOOT2_CLKDIV 4
+#endif
+
+/* Hardware Register Definitions */
+
+/* Base address for XIP (Execute In Place) peripheral */
+#define XIP_BASE                    (0x10000000)
+
+/* SSI (Synchronous Serial Interface) Registers
+ * Used for communication with external flash memory */
+#define SSI_BASE                    (0x18000000)
+#define SSI_CTRLR0                  (*(volatile uint32_t *) (SSI_BASE + 0x000))
+#define SSI_SSIENR                  (*(volatile uint32_t *) (SSI_BASE + 0x008))
+#define SSI_BAUDR                   (*(volatile uint32_t *) (SSI_BASE + 0x014))
+#define SSI_SR                      (*(volatile uint32_t *) (SSI_BASE + 0x028))
+#define SSI_DR0                     (*(volatile uint32_t *) (SSI_BASE + 0x060))
+#define SSI_RX_SAMPLE_DLY           (*(volatile uint32_t *) (SSI_BASE + 0x0f0))
+#define SSI_SPI_CTRLR0              (*(volatile uint32_t *) (SSI_BASE + 0x0f4))
+
+/* SSI status register bits */
+#define SSI_SR_BUSY                 (1 << 0)
+#define SSI_SR_TFE                  (1 << 2)
+
+/* Flash command and mode bits
+ * Mode bits M5-4 = 10 keep the flash in continuous read after each access */
+#define FLASH_CMD_READ_QUAD_IO      0xEB
+#define FLASH_MODE_CONTINUOUS_READ  0xA0
+
+/* SPI_CTRLR0 fields */
+#define SPI_TRANS_1C2A              (1 << 0)    /* Command serial, address quad */
+#define SPI_TRANS_2C2A              (2 << 0)    /* Command and address quad */
+#define SPI_ADDR_L_32               (8 << 2)    /* 24-bit address + 8 mode bits */
+#define SPI_INST_L_NONE             (0 << 8)
+#define SPI_INST_L_8                (2 << 8)
+#define SPI_WAIT_CYCLES             (4 << 11)   /* Dummy clocks after mode bits */
+#define SPI_XIP_CMD(cmd)            ((cmd) << 24)
+
+/* ARM Cortex-M0+ Core Registers */
+#define M0PLUS_BASE                 (0xe0000000)
+#define M0PLUS_VTOR                 (*(volatile uint32_t *) (M0PLUS_BASE + 0xed08))
+
+/* Wait until the transmit FIFO is empty and the SSI is idle */
+static inline void __attribute__((always_inline)) ssiWait(void)
+{
+    while (!(SSI_SR & SSI_SR_TFE) || (SSI_SR & SSI_SR_BUSY));
+}
+
+/* Boot stage 2 entry point
+ * This function is placed in .boot2 section by the linker. The code is
+ * position independent, so a copy in SRAM can also be called as a plain
+ * function: it then sets up the SSI and returns */
+__attribute__((section(".boot2"))) void bootStage2(void)
+{
+    // 0. The bootrom enters with lr = 0, the flash store (src/store.c)
+    //    calls a copy in SRAM to restore XIP after erase or program
+    uint32_t caller = (uint32_t)__builtin_return_address(0);
+
+    // 1. Setup IO_QSPI pins for XIP (already done by bootrom)
+
+    // 2. Setup SSI interface
+    //  - Read 2 byte status register
+    SSI_SSIENR = 0; // Disable SSI to configure it
+    SSI_BAUDR = BOOT2_CLKDIV; // Set clock divider
+#if BOOT2_CLKDIV <= 2
+    SSI_RX_SAMPLE_DLY = 1; // Sample RX one system clock late to meet flash output timing
+#endif
+    SSI_CTRLR0 = (7 << 16); // Set 8 clocks per data frame
+    SSI_SSIENR = 1; // Enable SSI
+    SSI_DR0 = 0x05; // Read Status Register 1
+    SSI_DR0 = 0x35; // Read Status Register 2
+    ssiWait();
+    uint8_t stReg1 = SSI_DR0; // Copy Status Register 1 value
+    uint8_t stReg2 = SSI_DR0; // Copy Status Register 2 value
+    //  - If QE bit is not set, then set QE bit
+    if (!(stReg2 & 1 << 1))
+    {
+        SSI_DR0 = 0x06; // Execute Write Enable Instruction
+        SSI_DR0 = 0x01; // Execute Write Status Register Instruction
+        SSI_DR0 = stReg1; // Write Status Register 1 value
+        SSI_DR0 = stReg2 | 1 << 1; // Status Register 2 value
+        SSI_DR0 = 0x04; // Execute Write Disable Instruction
+        ssiWait();
+    }
+
+    //  - Issue one Fast Read Quad I/O (EBh) with continuous read mode bits
+    SSI_SSIENR = 0; // Disable SSI to configure it
+    SSI_CTRLR0 = (3 << 8) | (31 << 16) | (2 << 21); // Set SPI frame format to 0x2, EEPROM mode and 32 clocks per data frame
+    SSI_SPI_CTRLR0 = SPI_TRANS_1C2A | SPI_ADDR_L_32 | SPI_INST_L_8 | SPI_WAIT_CYCLES;
+    SSI_SSIENR = 1; // Enable SSI
+    SSI_DR0 = FLASH_CMD_READ_QUAD_IO; // Command
+    SSI_DR0 = FLASH_MODE_CONTINUOUS_READ; // Address 0 followed by the mode bits
+    ssiWait();
+
+    //  - Flash is now in continuous read, drop the command from XIP accesses
+    //    and append the mode bits to every address instead
+    SSI_SSIENR = 0; // Disable SSI to configure it
+    SSI_SPI_CTRLR0 = SPI_XIP_CMD(FLASH_MODE_CONTINUOUS_READ) | SPI_TRANS_2C2A | SPI_ADDR_L_32 | SPI_INST_L_NONE | SPI_WAIT_CYCLES;
+    SSI_SSIENR = 1; // Enable SSI
+
+    // 3. Enable XIP Cache
+    // It is enabled by default. Take a look at https://datasheets.raspberrypi.com/rp2040/rp2040-datasheet.pdf#page=128
+
+    // Called as a function, only XIP had to be set up again
+    if (caller != 0) {
+        return;
+    }
+
+    // Mimic non-rp2040 Arm microcontroller behavior
+    // 1. Set correct VTOR value
+    M0PLUS_VTOR = XIP_BASE + 0x100; // Start of flash + boot stage 2 size
+
+    // 2. Load the stack pointer from the first entry in the vector table
+    asm("msr msp, %0" :: "r"(*(uint32_t *)(M0PLUS_VTOR + 0x0)));
+
+    // 3. Call the resetHandler using the second entry in the vector table
+    asm("bx %0" :: "r"(*(uint32_t *)(M0PLUS_VTOR + 0x4)));
+
+    // Just to be safe if we come back here
+    while(true);
+}
@@ -1,89 +1,317 @@
+/* Boot Stage 2 CRC Tool
+ * The bootrom only runs boot2 if the CRC-32/MPEG2 of its first 252 bytes
+ * matches the little-endian word in bytes 252-255. This host tool
+ * computes that CRC:
+ *
+ *   crc32 [-o crc.S] boot2.bin     Emit the .crc section as an assembly
+ *                                  blob for the link (default: crc.S next
+ *                                  to the input)
+ *   crc32 -p image.bin...          Patch the CRC into bytes 252-255 of
+ *                                  each flash image in place
+ *   crc32 -p -l list.txt           Same for every image listed one per
+ *                                  line, "-" reads the list from stdin
+ *   crc32 -s file...               Print the CRC of whole files
+ *
+ * CRC-32/MPEG2: polynomial 0x04c11db7, MSB first, init 0xffffffff, no
+ * final xor, check value 0x0376e6e7 for "123456789". Data is streamed in
+ * blocks through slice-by-8 tables generated at compile time, so image
+ * and file sizes are not limited and batch runs stay in one process */
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
 #include <string>
-#include <cstdint>
-#include <filesystem>
-#include "CRCpp/inc/CRC.h"
+#include <vector>
+
+namespace {
+
+constexpr uint32_t crcPolynomial = 0x04c11db7;
+constexpr uint32_t crcInit = 0xffffffff;
+constexpr uint32_t crcCheck = 0x0376e6e7;
 
-int main(int argc, char* argv[])
+/* Bytes the bootrom checksums, the CRC follows them */
+constexpr size_t boot2Bytes = 252;
+
+/* Stream block size */
+constexpr size_t blockBytes = 64 * 1024;
+
+typedef std::array<std::array<uint32_t, 256>, 8> crcTables;
+
+/* tables[0] is the classic byte table, tables[k] advances a byte that is
+ * followed by k more */
+constexpr crcTables makeTables()
 {
-    std::string binFilePath;
-    std::ifstream binFile;
-    
-    /* Bail if enough arguments are not provided */
-    if (argc < 2)
-    {
-        std::cout << "An input file with .bin extension must be provided. Exiting ..." << std::endl;
-        return 1;
+    crcTables tables{};
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000U) ? (crc << 1) ^ crcPolynomial : crc << 1;
+        }
+        tables[0][i] = crc;
     }
-     
-    /* Get the path of the .bin file */
-    binFilePath = std::string(argv[1]);
-    
-    // Bail if file name doesn't have .bin extension
-    if (binFilePath.length() < 4 || binFilePath.substr(binFilePath.length() - 4) != ".bin")
-    {
-        std::cout << "The input file must have .bin extension. Exiting ..." << std::endl;
-        return 1;
+    for (size_t k = 1; k < 8; k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t prev = tables[k - 1][i];
+            tables[k][i] = (prev << 8) ^ tables[0][prev >> 24];
+        }
     }
-    
-    // Open the file to check if it exists
-    binFile.open(binFilePath.c_str(), std::ios::binary);
-    if (!binFile.is_open())
-    {
-        std::cout << "Could not locate file: " << binFilePath << ". Exiting ..." << std::endl;
-        return 1;
+    return tables;
+}
+
+constexpr crcTables tables = makeTables();
+
+uint32_t crcUpdate(uint32_t crc, const uint8_t *data, size_t length)
+{
+    /* Eight bytes per step: four folded into the CRC, four indexed
+       directly */
+    while (length >= 8) {
+        crc ^= (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+               (uint32_t)data[2] << 8 | (uint32_t)data[3];
+        crc = tables[7][crc >> 24] ^ tables[6][(crc >> 16) & 0xff] ^
+              tables[5][(crc >> 8) & 0xff] ^ tables[4][crc & 0xff] ^
+              tables[3][data[4]] ^ tables[2][data[5]] ^
+              tables[1][data[6]] ^ tables[0][data[7]];
+        data += 8;
+        length -= 8;
     }
-    
-    /* Get file size */
-    binFile.seekg(0, std::ios::end);
-    size_t binFileSize = binFile.tellg();
-    binFile.seekg(0, std::ios::beg);
-    
-    /* Bail if it is > 252 bytes in size */
-    if (binFileSize > 252)
-    {
-        std::cout << "The input must be 252 Bytes in size at max. Exiting ..." << std::endl;
-        binFile.close();
-        return 1;
+    while (length-- != 0) {
+        crc = (crc << 8) ^ tables[0][(crc >> 24) ^ *data++];
+    }
+    return crc;
+}
+
+/* Reference bit-at-a-time CRC, only for the self test */
+constexpr uint32_t crcBitwise(const char *data, size_t length)
+{
+    uint32_t crc = crcInit;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint32_t)(uint8_t)data[i] << 24;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000U) ? (crc << 1) ^ crcPolynomial : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static_assert(crcBitwise("123456789", 9) == crcCheck, "CRC-32/MPEG2 check value");
+
+bool selfTest()
+{
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    return crcUpdate(crcInit, check, sizeof check) == crcCheck;
+}
+
+/* CRC of a whole file, streamed */
+bool crcFile(const std::string &path, uint32_t &crc)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> block(blockBytes);
+
+    if (!file.is_open()) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
     }
-    
-    /* Load the file contents into an array */
-    unsigned char binFileData[252] = {0};
-    binFile.read(reinterpret_cast<char*>(binFileData), 252);
-    binFile.close();
-    
-    /* Calculate CRC32 for the 252 bytes of data */
-    unsigned char crc[4] = {0};
-    *reinterpret_cast<uint32_t*>(crc) = CRC::Calculate(binFileData, 252, CRC::CRC_32_MPEG2());
-    
-    /* Get the directory path of the input file */
-    std::string dirPath = binFilePath.substr(0, binFilePath.find_last_of("/\\"));
-    
-    /* Create the output file path */
-    std::string outFilePath = dirPath + "/crc.c";
-    
-    /* Output the contents of the crc array to crc.c */
-    std::ofstream cppFile(outFilePath.c_str());
-    if (!cppFile.is_open())
-    {
-        std::cout << "Failed to create output file: " << outFilePath << std::endl;
+    crc = crcInit;
+    while (file) {
+        file.read(reinterpret_cast<char *>(block.data()), block.size());
+        crc = crcUpdate(crc, block.data(), (size_t)file.gcount());
+    }
+    return !file.bad();
+}
+
+/* CRC of the boot2 area, zero padded to 252 bytes
+ * A standalone boot2 binary may be shorter and must not be longer, a
+ * flash image is longer and only its first 252 bytes count */
+bool crcBoot2(std::istream &in, const std::string &path, bool image, uint32_t &crc)
+{
+    uint8_t data[boot2Bytes + 1] = {};
+
+    in.read(reinterpret_cast<char *>(data), sizeof data);
+    size_t length = (size_t)in.gcount();
+    if (in.bad()) {
+        std::cerr << "Could not read " << path << std::endl;
+        return false;
+    }
+    if (!image && length > boot2Bytes) {
+        std::cerr << path << " is larger than " << boot2Bytes << " bytes" << std::endl;
+        return false;
+    }
+    crc = crcUpdate(crcInit, data, boot2Bytes);
+    return true;
+}
+
+/* The linker script places .crc right after the 252 boot2 bytes */
+bool emitAssembly(const std::string &binPath, const std::string &outPath)
+{
+    std::ifstream bin(binPath, std::ios::binary);
+    uint32_t crc;
+
+    if (!bin.is_open()) {
+        std::cerr << "Could not open " << binPath << std::endl;
+        return false;
+    }
+    if (!crcBoot2(bin, binPath, false, crc)) {
+        return false;
+    }
+
+    std::ofstream out(outPath);
+    if (!out.is_open()) {
+        std::cerr << "Failed to create output file: " << outPath << std::endl;
+        return false;
+    }
+    char word[16];
+    std::snprintf(word, sizeof word, "0x%08x", crc);
+    out << "/* Generated by crc32 from " << binPath << " */\n"
+        << "    .section .crc, \"a\"\n"
+        << "    .global crc\n"
+        << "crc:\n"
+        << "    .4byte " << word << "\n";
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write " << outPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* Store the CRC little endian in bytes 252-255 of a flash image */
+bool patchImage(const std::string &path)
+{
+    std::fstream image(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t crc;
+
+    if (!image.is_open()) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    image.seekg(0, std::ios::end);
+    if (image.tellg() < (std::streamoff)(boot2Bytes + 4)) {
+        std::cerr << path << " is too short to hold boot2 and its CRC" << std::endl;
+        return false;
+    }
+    image.seekg(0);
+    if (!crcBoot2(image, path, true, crc)) {
+        return false;
+    }
+
+    const char bytes[4] = {
+        (char)(crc & 0xff), (char)((crc >> 8) & 0xff),
+        (char)((crc >> 16) & 0xff), (char)(crc >> 24)
+    };
+    image.clear();
+    image.seekp(boot2Bytes);
+    image.write(bytes, sizeof bytes);
+    image.close();
+    if (!image) {
+        std::cerr << "Failed to patch " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* Image paths one per line, blank lines skipped */
+bool readList(const std::string &listPath, std::vector<std::string> &paths)
+{
+    std::ifstream listFile;
+    std::istream *list = &std::cin;
+
+    if (listPath != "-") {
+        listFile.open(listPath);
+        if (!listFile.is_open()) {
+            std::cerr << "Could not open " << listPath << std::endl;
+            return false;
+        }
+        list = &listFile;
+    }
+    std::string line;
+    while (std::getline(*list, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            paths.push_back(line);
+        }
+    }
+    return true;
+}
+
+int usage()
+{
+    std::cerr << "Usage: crc32 [-o crc.S] boot2.bin\n"
+                 "       crc32 -p image.bin... | crc32 -p -l list.txt\n"
+                 "       crc32 -s file..." << std::endl;
+    return 1;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    enum { MODE_EMIT, MODE_PATCH, MODE_SUM } mode = MODE_EMIT;
+    std::string outPath;
+    std::vector<std::string> inputs;
+
+    /* Bail if the tables do not produce the check value */
+    if (!selfTest()) {
+        std::cerr << "CRC self test failed" << std::endl;
         return 1;
     }
-    
-    cppFile << "__attribute__((section(\".crc\"))) unsigned char crc[4] = {";
-    
-    /* Write each byte of CRC with proper formatting */ 
-    for (int i = 0; i < 3; i++) {
-        cppFile << "0x" << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<unsigned int>(crc[i]) << ", ";
-    }
-    cppFile << "0x" << std::hex << std::setw(2) << std::setfill('0')
-            << static_cast<unsigned int>(crc[3]) << "};";
-    
-    cppFile.close();
-    
-    std::cout << "Generated CRC file: " << outFilePath << std::endl;
-    return 0;
-}
\ No newline at end of file
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-o" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "-p") {
+            mode = MODE_PATCH;
+        } else if (arg == "-s") {
+            mode = MODE_SUM;
+        } else if (arg == "-l" && i + 1 < argc) {
+            if (!readList(argv[++i], inputs)) {
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            return usage();
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        return usage();
+    }
+
+    if (mode == MODE_EMIT) {
+        if (inputs.size() != 1) {
+            return usage();
+        }
+        /* Default output next to the input */
+        if (outPath.empty()) {
+            size_t slash = inputs[0].find_last_of("/\\");
+            outPath = (slash == std::string::npos ? std::string() : inputs[0].substr(0, slash + 1)) + "crc.S";
+        }
+        return emitAssembly(inputs[0], outPath) ? 0 : 1;
+    }
+
+    /* Batch modes keep going and report every failure */
+    int failures = 0;
+    for (const std::string &path : inputs) {
+        if (mode == MODE_PATCH) {
+            failures += patchImage(path) ? 0 : 1;
+        } else {
+            uint32_t crc;
+            if (crcFile(path, crc)) {
+                char word[16];
+                std::snprintf(word, sizeof word, "%08x", crc);
+                std::cout << word << "  " << path << "\n";
+            } else {
+                failures++;
+            }
+        }
+    }
+    if (failures != 0) {
+        std::cerr << failures << " of " << inputs.size() << " files failed" << std::endl;
+    }
+    return failures != 0 ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/* Audio Receive
+ * Both channels read the ADC FIFO and write with a 128-byte address
+ * ring, A into the first block and B into the second, each chained to
+ * the other. A channel that finishes is left with the write address of
+ * the other block, so dmaIrq1 writes its start back through the
+ * non-triggering alias (the transfer count reloads by itself) before the
+ * partner's chain restarts it. Should the interrupt ever come late, the
+ * ring keeps the channel inside the buffer */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "instrument.h"
+#include "toneDetect.h"
+#include "audioRx.h"
+
+#define RING_BITS 7
+#define CH_MASK(ch) (1U << (ch))
+#define AUDIO_CH_MASK (CH_MASK(AUDIO_RX_DMA_CH_A) | CH_MASK(AUDIO_RX_DMA_CH_B))
+
+#define AUDIO_DMA_CTRL (DMA_CTRL_EN | DMA_CTRL_DATA_SIZE_BYTE | DMA_CTRL_INCR_WRITE | \
+                        DMA_CTRL_RING_SIZE(RING_BITS) | DMA_CTRL_RING_SEL_WRITE | \
+                        DMA_CTRL_TREQ_SEL(DREQ_ADC))
+
+typedef char audioRingFitsBlocks[(1U << RING_BITS) == 2 * TONE_DETECT_BLOCK ? 1 : -1];
+
+/* Aligned to its size so the DMA write ring wraps at its end */
+static uint8_t audioRing[2 * TONE_DETECT_BLOCK] __attribute__((aligned(2 * TONE_DETECT_BLOCK)));
+
+static audioRxEdge edgeCallback;
+static volatile bool keyDown;
+static volatile uint32_t overruns;
+
+/* Program a channel for its block without starting it */
+static void channelSetup(uint32_t ch, uint32_t chainTo, uint32_t slot)
+{
+    volatile struct dma_channel_hw *c = &dma->ch[ch];
+    c->read_addr = (uint32_t)&adc->fifo;
+    c->write_addr = (uint32_t)&audioRing[slot * TONE_DETECT_BLOCK];
+    c->transfer_count = TONE_DETECT_BLOCK;
+    c->al1_ctrl = AUDIO_DMA_CTRL | DMA_CTRL_CHAIN_TO(chainTo);
+}
+
+bool audioRxInit(uint32_t pin, uint32_t toneHz, uint32_t sampleHz, audioRxEdge edge)
+{
+    uint32_t adcHz = clockGetHz(CLK_ADC);
+
+    if (adcHz == 0 || pin < ADC_FIRST_PIN || pin > ADC_FIRST_PIN + 3) {
+        return false;
+    }
+
+    RESETS_RESET &= ~(RESET_ADC | RESET_DMA);
+    while ((RESETS_RESET_DONE & (RESET_ADC | RESET_DMA)) != (RESET_ADC | RESET_DMA)) {}
+
+    toneDetectInit(toneHz, sampleHz);
+    edgeCallback = edge;
+    keyDown = false;
+    overruns = 0;
+
+    /* Analogue input: no function, digital input and output off */
+    io->gpio[pin].ctrl = GPIO_FUNC_NULL;
+    pads->gpio[pin] = PADS_GPIO_OD;
+
+    adc->cs = ADC_CS_EN;
+    while ((adc->cs & ADC_CS_READY) == 0) {}
+
+    /* Sample period:
+       1. adcHz / sampleHz cycles of clk_adc, in 16.8 fixed point
+       2. The ADC adds one cycle to div itself */
+    uint32_t cycles = hwDivide(adcHz, sampleHz);
+    uint32_t frac = hwDivide((adcHz - cycles * sampleHz) << 8, sampleHz);
+    adc->div = ((cycles - 1) << 8) | frac;
+
+    /* 8-bit samples, a DMA request for every one, sticky flags cleared */
+    adc->fcs = ADC_FCS_EN | ADC_FCS_SHIFT | ADC_FCS_DREQ_EN | ADC_FCS_THRESH(1) |
+               ADC_FCS_OVER | ADC_FCS_UNDER;
+
+    channelSetup(AUDIO_RX_DMA_CH_A, AUDIO_RX_DMA_CH_B, 0);
+    channelSetup(AUDIO_RX_DMA_CH_B, AUDIO_RX_DMA_CH_A, 1);
+    dma->ints1 = AUDIO_CH_MASK;
+    dma->inte1 |= AUDIO_CH_MASK;
+    NVIC_ISER = 1U << DMA_IRQ_1;
+    dma->multi_chan_trigger = CH_MASK(AUDIO_RX_DMA_CH_A);
+
+    adc->cs = ADC_CS_EN | ADC_CS_AINSEL(pin - ADC_FIRST_PIN) | ADC_CS_START_MANY;
+    return true;
+}
+
+bool audioRxKeyDown(void)
+{
+    return keyDown;
+}
+
+uint32_t audioRxOverruns(void)
+{
+    return overruns;
+}
+
+/* Interrupt handler for DMA_IRQ_1
+ * Overrides the weak alias in startup.c, runs from SRAM with the detector
+ * so a block never waits on an XIP cache miss */
+void __not_in_flash_func(dmaIrq1)(void)
+{
+    uint32_t start = instrEnter();
+    uint32_t status = dma->ints1 & AUDIO_CH_MASK;
+    uint32_t now = timer->timerawl;
+
+    dma->ints1 = status;
+    if (status == AUDIO_CH_MASK) {
+        overruns = overruns + 1;
+    }
+
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        uint32_t ch = slot == 0 ? AUDIO_RX_DMA_CH_A : AUDIO_RX_DMA_CH_B;
+        if ((status & CH_MASK(ch)) == 0) {
+            continue;
+        }
+
+        const uint8_t *block = &audioRing[slot * TONE_DETECT_BLOCK];
+        dma->ch[ch].write_addr = (uint32_t)block;
+
+        bool down = toneDetectBlock(block);
+        if (down != keyDown) {
+            keyDown = down;
+            edgeCallback(now, down);
+        }
+    }
+
+    instrRecord(INSTR_AUDIO_BLOCK, instrElapsed(start));
+}
@@ -0,0 +1,47 @@
+/* Audio Receive
+ * Decodes Morse received as audio on an ADC pin. The ADC free-runs at
+ * the sample rate into its FIFO, from where two chained DMA channels
+ * fill the two halves of a 128-byte ring, one 64-sample block each.
+ * dmaIrq1 runs once per block: it re-arms the channel that finished
+ * and passes the block through the tone detector (toneDetect.h). A
+ * change of the key state goes to the edge callback with the TIMER time
+ * the block ended, in the form the decoder takes from a debounced key.
+ *
+ * Costs one interrupt per block, every 8 ms at 8 kS/s. INSTRUMENT
+ * builds record the cycles of each block in INSTR_AUDIO_BLOCK */
+
+#ifndef AUDIO_RX_H
+#define AUDIO_RX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DMA channels used, 0 and 1 belong to toneDma.h and 2 to uartRx.h
+ * DMA_IRQ_1 is shared with uartRx.h, a build has one of the two */
+#define AUDIO_RX_DMA_CH_A 3
+#define AUDIO_RX_DMA_CH_B 4
+
+/* Called from dmaIrq1 on every change of the detected key state */
+typedef void (*audioRxEdge)(uint32_t timestampUs, bool down);
+
+/* Sample pin (GPIO26-29) at sampleHz and detect toneHz, starting at
+ * once. Call after clocksInit(). Returns false if pin has no ADC input
+ * or the clock profile stops clk_adc */
+bool audioRxInit(uint32_t pin, uint32_t toneHz, uint32_t sampleHz, audioRxEdge edge);
+
+/* The key state last reported */
+bool audioRxKeyDown(void);
+
+/* Interrupts that found both blocks full, so the detector ran late on
+ * samples that were already being overwritten */
+uint32_t audioRxOverruns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_RX_H */
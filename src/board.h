@@ -0,0 +1,103 @@
+/* Board Profile
+ * Pin assignment of the board selected with BOARD= in the Makefile,
+ * which passes -DBOARD_HEADER=<name>.h for a profile in boards/. A
+ * profile is nothing but #defines, so the pin typedefs, masks and pad
+ * values built from it fold to literals and a differently wired board
+ * costs nothing at run time. Without BOARD_HEADER the Pico wiring is
+ * used.
+ *
+ * Conflicts between the pins a build uses are caught here, at compile
+ * time, including UART0 functions on pins that cannot carry them */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOARD_STRINGIFY(x) #x
+#define BOARD_INCLUDE(x) BOARD_STRINGIFY(x)
+
+#ifdef BOARD_HEADER
+#include BOARD_INCLUDE(BOARD_HEADER)
+#else
+#include "../boards/pico.h"
+#endif
+
+#if !defined(BUTTON_PIN) || !defined(BUTTON_ACTIVE_LOW) || \
+    !defined(SPEAKER_PIN) || !defined(LED_PIN) || \
+    !defined(IAMBIC_DIT_PIN) || !defined(IAMBIC_DAH_PIN) || \
+    !defined(UART_TX_PIN) || !defined(UART_RX_PIN) || !defined(UART_RTS_PIN) || \
+    !defined(BEACON_FIRST_PIN) || !defined(BEACON_MAX_CHANNELS)
+#error "Board profile is missing a pin, see boards/pico.h for the full set"
+#endif
+
+/* Button pad: an input pulled towards the released level, up for a
+ * button that closes to ground and down for one that closes to 3V3, so
+ * a released button never reads pressed. A profile only adds other pad
+ * flags, such as the Schmitt trigger, in BUTTON_PAD_EXTRA */
+#if defined(BUTTON_PAD)
+#error "Board profile: BUTTON_PAD follows BUTTON_ACTIVE_LOW, set BUTTON_PAD_EXTRA instead"
+#endif
+#ifndef BUTTON_PAD_EXTRA
+#define BUTTON_PAD_EXTRA 0
+#endif
+#define BUTTON_PAD ((BUTTON_ACTIVE_LOW ? PADS_GPIO_PUE : PADS_GPIO_PDE) | PADS_GPIO_IE | BUTTON_PAD_EXTRA)
+
+/* Pins every build uses, and those of the optional inputs */
+#define BOARD_BASE_MASK ((1U << BUTTON_PIN) | (1U << SPEAKER_PIN) | (1U << LED_PIN))
+#define BOARD_PADDLE_MASK ((1U << IAMBIC_DIT_PIN) | (1U << IAMBIC_DAH_PIN))
+#define BOARD_UART_MASK ((1U << UART_TX_PIN) | (1U << UART_RX_PIN) | (1U << UART_RTS_PIN))
+
+#if BUTTON_PIN == SPEAKER_PIN || BUTTON_PIN == LED_PIN || SPEAKER_PIN == LED_PIN
+#error "Board profile: button, speaker and LED need their own pins"
+#endif
+
+#if defined(BUTTON_IAMBIC)
+#if IAMBIC_DIT_PIN == IAMBIC_DAH_PIN || (BOARD_BASE_MASK & BOARD_PADDLE_MASK) != 0
+#error "Board profile: paddle pins overlap"
+#endif
+#endif
+
+#if defined(UART_INPUT)
+/* UART0 TX on 0/12/16/28, RX on 1/13/17/29, RTS on 3/15/19 */
+#if (UART_TX_PIN != 0 && UART_TX_PIN != 12 && UART_TX_PIN != 16 && UART_TX_PIN != 28) || \
+    (UART_RX_PIN != 1 && UART_RX_PIN != 13 && UART_RX_PIN != 17 && UART_RX_PIN != 29) || \
+    (UART_RTS_PIN != 3 && UART_RTS_PIN != 15 && UART_RTS_PIN != 19)
+#error "Board profile: UART pins cannot carry UART0"
+#endif
+#if (BOARD_BASE_MASK & BOARD_UART_MASK) != 0
+#error "Board profile: UART pins overlap"
+#endif
+#endif
+
+#if defined(AUDIO_RX)
+#if !defined(AUDIO_PIN)
+#error "Board profile has no AUDIO_PIN for audio receive"
+#endif
+#if AUDIO_PIN < 26 || AUDIO_PIN > 29
+#error "Board profile: AUDIO_PIN must be an ADC input, GPIO26-29"
+#endif
+#if (BOARD_BASE_MASK & (1U << AUDIO_PIN)) != 0
+#error "Board profile: AUDIO_PIN overlaps"
+#endif
+#endif
+
+#if defined(BEACON_CHANNELS)
+#define BOARD_BEACON_MASK (((1U << BEACON_CHANNELS) - 1) << BEACON_FIRST_PIN)
+#if BEACON_CHANNELS > BEACON_MAX_CHANNELS
+#error "Board profile has fewer free pins than beacon channels"
+#endif
+#if (BOARD_BASE_MASK & BOARD_BEACON_MASK) != 0 || \
+    (defined(BUTTON_IAMBIC) && (BOARD_PADDLE_MASK & BOARD_BEACON_MASK) != 0) || \
+    (defined(UART_INPUT) && (BOARD_UART_MASK & BOARD_BEACON_MASK) != 0)
+#error "Board profile: beacon pins overlap"
+#endif
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOARD_H */
@@ -0,0 +1,236 @@
+/* Multi-Channel Keyer
+ * The running channels sit in a binary min-heap on their deadlines, so
+ * the alarm always targets the root. Each event:
+ * 1. Takes the root while its deadline has come: the channel steps to
+ *    its next symbol, its key bits go into the clear or set mask, and it
+ *    sinks to its new deadline's place (or leaves the heap at its end)
+ * 2. Stores both masks once, so N coincident edges cost one pair of SIO
+ *    writes and one interrupt, not N
+ * Channels that are not due are not looked at beyond the sift, so an
+ * event costs O(log N) per edge instead of a pass over every channel */
+
+#include "rp2040.h"
+#include "scheduler.h"
+#include "instrument.h"
+#include "channels.h"
+
+/* Alarm used by the channels, one of TIMER alarms 0-3 */
+#define CHANNELS_ALARM 3
+
+typedef char channelsFitMask[(CHANNELS_MAX <= 32) ? 1 : -1];
+
+struct channel {
+    const uint8_t *symbols;
+    uint32_t count;
+    uint32_t next;          /* Index of the next symbol */
+    uint32_t keyMask;       /* SIO outputs driven high while keyed */
+    uint32_t ditUs;
+    uint32_t deadline;      /* TIMER time of the channel's next edge */
+    bool repeat;
+};
+
+static struct channel channelTable[CHANNELS_MAX];
+static volatile uint32_t activeMask;    /* Channels with a running timeline */
+
+/* The running channels, earliest deadline first at heap[0]. Each entry
+ * carries a copy of its channel's deadline so the sift compares without
+ * following the index. Changed by service() and with interrupts disabled
+ * only */
+struct heapEntry {
+    uint32_t deadline;
+    uint32_t channel;
+};
+
+static struct heapEntry heap[CHANNELS_MAX];
+static uint32_t heapCount;
+
+static inline bool __not_in_flash_func(earlier)(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+/* Move heap[at] down until neither child is due before it */
+static inline void __not_in_flash_func(siftDown)(uint32_t at)
+{
+    struct heapEntry entry = heap[at];
+
+    for (;;) {
+        uint32_t child = 2 * at + 1;
+        if (child >= heapCount) {
+            break;
+        }
+        if (child + 1 < heapCount && earlier(heap[child + 1].deadline, heap[child].deadline)) {
+            child++;
+        }
+        if (!earlier(heap[child].deadline, entry.deadline)) {
+            break;
+        }
+        heap[at] = heap[child];
+        at = child;
+    }
+    heap[at] = entry;
+}
+
+/* Heap of every channel in activeMask, after starts and stops */
+static void rebuildHeap(void)
+{
+    heapCount = 0;
+    for (uint32_t i = 0; i < CHANNELS_MAX; i++) {
+        if ((activeMask & (1U << i)) != 0) {
+            heap[heapCount].deadline = channelTable[i].deadline;
+            heap[heapCount].channel = i;
+            heapCount++;
+        }
+    }
+    for (uint32_t at = heapCount / 2; at-- != 0;) {
+        siftDown(at);
+    }
+}
+
+/* Arm the alarm for deadline, forced if it already passed (scheduler.c) */
+static void __not_in_flash_func(armAlarm)(uint32_t deadline)
+{
+    timer->alarm[CHANNELS_ALARM] = deadline;
+    if ((int32_t)(deadline - timer->timerawl) <= 0) {
+        timer->intf |= 1U << CHANNELS_ALARM;
+    }
+}
+
+/* Next symbol of a channel, 0 at the end of a one-shot timeline */
+static inline uint8_t nextSymbol(struct channel *c)
+{
+    if (c->next == c->count) {
+        if (!c->repeat) {
+            return 0;
+        }
+        c->next = 0;
+    }
+    return c->symbols[c->next++];
+}
+
+/* Apply every edge due by now and re-arm for the earliest deadline
+ * Called from the alarm interrupt, or with interrupts disabled to start */
+static void __not_in_flash_func(service)(uint32_t now)
+{
+    uint32_t setMask = 0;
+    uint32_t clrMask = 0;
+    uint32_t running = activeMask;
+    uint32_t stepped = 0;
+
+    while (heapCount != 0) {
+        uint32_t i = heap[0].channel;
+        struct channel *c = &channelTable[i];
+
+        /* One step per channel and event, a channel that is still due
+         * after it (a late event) is taken by the forced next one */
+        if ((int32_t)(heap[0].deadline - now) > 0 || (stepped & (1U << i)) != 0) {
+            break;
+        }
+        stepped |= 1U << i;
+
+        uint8_t symbol = nextSymbol(c);
+        if (symbol == 0) {
+            clrMask |= c->keyMask;      /* Always finish with the key up */
+            running &= ~(1U << i);
+            heap[0] = heap[--heapCount];
+        } else {
+            if (symbol & SYMBOL_KEY_DOWN) {
+                setMask |= c->keyMask;
+            } else {
+                clrMask |= c->keyMask;
+            }
+            c->deadline += (symbol & SYMBOL_UNITS_MASK) * c->ditUs;
+            heap[0].deadline = c->deadline;
+        }
+        siftDown(0);
+    }
+
+    sio->gpio_out_clr = clrMask;
+    sio->gpio_out_set = setMask;
+    if ((setMask | clrMask) != 0) {
+        instrEdge();
+    }
+
+    activeMask = running;
+    if (heapCount != 0) {
+        armAlarm(heap[0].deadline);
+    }
+}
+
+/* Interrupt handler for TIMER alarm 3
+ * Overrides the weak alias in startup.c, runs from SRAM */
+void __not_in_flash_func(timerIrq3)(void)
+{
+    timer->intf &= ~(1U << CHANNELS_ALARM);  /* Drop a forced interrupt */
+    timer->intr = 1U << CHANNELS_ALARM;      /* Clear the alarm interrupt */
+    service(timer->timerawl);
+}
+
+void channelsInit(void)
+{
+    /* The scheduler may not own the timer in every build */
+    RESETS_RESET &= ~RESET_TIMER;
+    while ((RESETS_RESET_DONE & RESET_TIMER) == 0) {}
+
+    activeMask = 0;
+    heapCount = 0;
+    timer->intr = 1U << CHANNELS_ALARM;
+    timer->inte |= 1U << CHANNELS_ALARM;
+    NVIC_ISER = 1U << (TIMER_IRQ_0 + CHANNELS_ALARM);
+}
+
+void channelsConfigure(uint32_t channel, uint32_t keyMask, uint32_t ditUs)
+{
+    channelTable[channel].keyMask = keyMask;
+    channelTable[channel].ditUs = ditUs;
+}
+
+void channelsLoad(uint32_t channel, const uint8_t *symbols, uint32_t count, bool repeat)
+{
+    channelsStop(1U << channel);
+
+    struct channel *c = &channelTable[channel];
+    c->symbols = symbols;
+    c->count = count;
+    c->next = 0;
+    c->repeat = repeat;
+}
+
+void channelsStart(uint32_t channelMask)
+{
+    uint32_t primask = irqDisable();
+    uint32_t now = timer->timerawl;
+
+    for (uint32_t i = 0; i < CHANNELS_MAX; i++) {
+        struct channel *c = &channelTable[i];
+        if ((channelMask & (1U << i)) != 0 && c->count != 0) {
+            c->next = 0;
+            c->deadline = now;
+            activeMask |= 1U << i;
+        }
+    }
+    rebuildHeap();
+    service(now);
+    irqRestore(primask);
+}
+
+void channelsStop(uint32_t channelMask)
+{
+    uint32_t primask = irqDisable();
+    uint32_t keys = 0;
+
+    for (uint32_t i = 0; i < CHANNELS_MAX; i++) {
+        if ((channelMask & activeMask & (1U << i)) != 0) {
+            keys |= channelTable[i].keyMask;
+        }
+    }
+    activeMask &= ~channelMask;
+    rebuildHeap();
+    sio->gpio_out_clr = keys;
+    irqRestore(primask);
+}
+
+bool channelsIdle(uint32_t channelMask)
+{
+    return (activeMask & channelMask) == 0;
+}
@@ -0,0 +1,54 @@
+/* Multi-Channel Keyer
+ * Plays up to CHANNELS_MAX independent symbol timelines (scheduler.h
+ * format) on TIMER alarm 3, each keying its own SIO outputs, for example
+ * one beacon transmitter per channel.
+ *
+ * Every channel keeps an absolute deadline that only ever advances by
+ * its own symbol lengths, and channels started together share one start
+ * time, so they never drift against each other. One alarm event serves
+ * every channel that is due and merges their edges into one
+ * gpio_out_clr and one gpio_out_set store */
+
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of channels, at most 32 */
+#ifndef CHANNELS_MAX
+#define CHANNELS_MAX 8
+#endif
+
+/* Release TIMER from reset and claim alarm 3 */
+void channelsInit(void);
+
+/* Set the outputs a channel keys and its dit length
+ * Only for a stopped channel */
+void channelsConfigure(uint32_t channel, uint32_t keyMask, uint32_t ditUs);
+
+/* Attach count symbols to a channel, stopping it first
+ * The symbols are played in place and must stay valid while the channel
+ * runs. repeat restarts them at the end instead of stopping, a beacon
+ * ends its symbols with the key up pause between repeats */
+void channelsLoad(uint32_t channel, const uint8_t *symbols, uint32_t count, bool repeat);
+
+/* Start every loaded channel in channelMask (bit n = channel n) from the
+ * same instant, their first edges go out before this returns */
+void channelsStart(uint32_t channelMask);
+
+/* Stop the channels in channelMask and release their keys */
+void channelsStop(uint32_t channelMask);
+
+/* True when none of the channels in channelMask is running */
+bool channelsIdle(uint32_t channelMask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHANNELS_H */
@@ -0,0 +1,154 @@
+/* Clock Initialization
+ * Follows the sequence in the RP2040 datasheet (section 2.15):
+ * 1. Start XOSC and wait for it to stabilise
+ * 2. Park clk_sys and clk_ref on glitchless sources
+ * 3. Lock PLL_SYS and PLL_USB from the crystal
+ * 4. Switch clk_ref, clk_sys, clk_peri, clk_usb, clk_adc and clk_rtc over */
+
+#include "rp2040.h"
+#include "clocks.h"
+
+/* XOSC control values */
+#define XOSC_CTRL_FREQ_1_15MHZ  0xaa0
+#define XOSC_CTRL_ENABLE        (0xfab << 12)
+#define XOSC_STATUS_STABLE      (1U << 31)
+/* Startup delay of ~1 ms in units of 256 crystal cycles */
+#define XOSC_STARTUP_DELAY      (((XOSC_HZ / 1000) + 128) / 256)
+
+/* PLL register bits */
+#define PLL_CS_LOCK             (1U << 31)
+#define PLL_PWR_PD              (1U << 0)
+#define PLL_PWR_POSTDIVPD       (1U << 3)
+#define PLL_PWR_VCOPD           (1U << 5)
+#define PLL_PRIM(pd1, pd2)      (((pd1) << 16) | ((pd2) << 12))
+
+/* Clock generator control bits */
+#define CLK_CTRL_ENABLE         (1U << 11)
+#define CLK_CTRL_AUXSRC(src)    ((src) << 5)
+#define CLK_DIV_INT(n)          ((n) << 8)
+
+#define CLK_REF_SRC_ROSC        0x0
+#define CLK_REF_SRC_XOSC        0x2
+#define CLK_SYS_SRC_REF         0x0
+#define CLK_SYS_SRC_AUX         0x1
+#define CLK_SYS_AUX_PLL_SYS     0x0
+#define CLK_PERI_AUX_CLK_SYS    0x0
+#define CLK_USB_AUX_PLL_USB     0x0     /* Also clk_adc and clk_rtc */
+#define CLK_USB_AUX_XOSC        0x3     /* Also clk_adc and clk_rtc */
+
+
+/* Frequencies of each generator after clocksInit() */
+static uint32_t clockHz[CLK_COUNT];
+
+/* Bring a PLL out of reset and lock it
+ * fout = XOSC_HZ * fbdiv / (pd1 * pd2), VCO must stay in 750-1600 MHz */
+static void pllStart(volatile struct pll_hw *pll, uint32_t resetBit,
+                     uint32_t fbdiv, uint32_t pd1, uint32_t pd2)
+{
+    RESETS_RESET |= resetBit;
+    RESETS_RESET &= ~resetBit;
+    while ((RESETS_RESET_DONE & resetBit) == 0) {}
+
+    pll->cs = 1;                                    /* Reference divider 1 */
+    pll->fbdiv_int = fbdiv;
+    pll->pwr &= ~(PLL_PWR_PD | PLL_PWR_VCOPD);      /* Power up VCO */
+    while ((pll->cs & PLL_CS_LOCK) == 0) {}
+
+    pll->prim = PLL_PRIM(pd1, pd2);
+    pll->pwr &= ~PLL_PWR_POSTDIVPD;                 /* Power up post dividers */
+}
+
+/* Configure an aux-only generator (peri, usb, adc, rtc)
+ * The generator is stopped while its source changes, as required for
+ * clocks without a glitchless mux. clk_peri has no divider, pass 0 */
+static void auxClockStart(enum clockId id, uint32_t auxsrc, uint32_t div,
+                          uint32_t hz)
+{
+    clocks->clk[id].ctrl &= ~CLK_CTRL_ENABLE;
+    if (div != 0) {
+        clocks->clk[id].div = CLK_DIV_INT(div);
+    }
+    clocks->clk[id].ctrl = CLK_CTRL_AUXSRC(auxsrc);
+    clocks->clk[id].ctrl |= CLK_CTRL_ENABLE;
+    clockHz[id] = hz;
+}
+
+static void auxClockStop(enum clockId id)
+{
+    clocks->clk[id].ctrl &= ~CLK_CTRL_ENABLE;
+    clockHz[id] = 0;
+}
+
+void clocksInit(enum clockProfile profile)
+{
+    uint32_t sysHz;
+
+    /* Resuscitation would switch clk_sys back to the ROSC behind our back */
+    clocks->resus_ctrl = 0;
+
+    /* 1. Start the crystal oscillator */
+    xosc->ctrl = XOSC_CTRL_FREQ_1_15MHZ;
+    xosc->startup = XOSC_STARTUP_DELAY;
+    xosc->ctrl |= XOSC_CTRL_ENABLE;
+    while ((xosc->status & XOSC_STATUS_STABLE) == 0) {}
+
+    /* 2. Run clk_sys from clk_ref and clk_ref from the ROSC while the PLLs
+          are reprogrammed, waiting for each glitchless mux to switch */
+    clocks->clk[CLK_SYS].ctrl &= ~0x1U;
+    while (clocks->clk[CLK_SYS].selected != (1U << CLK_SYS_SRC_REF)) {}
+    clocks->clk[CLK_REF].ctrl &= ~0x3U;
+    while (clocks->clk[CLK_REF].selected != (1U << CLK_REF_SRC_ROSC)) {}
+
+    /* 3. clk_ref from the crystal, undivided */
+    clocks->clk[CLK_REF].div = CLK_DIV_INT(1);
+    clocks->clk[CLK_REF].ctrl = CLK_REF_SRC_XOSC;
+    while (clocks->clk[CLK_REF].selected != (1U << CLK_REF_SRC_XOSC)) {}
+    clockHz[CLK_REF] = XOSC_HZ;
+
+    if (profile == CLOCK_PROFILE_XOSC) {
+        /* 4a. Low-power profile: clk_sys stays on clk_ref and both PLLs are
+               held in reset, which also keeps them powered down */
+        RESETS_RESET |= RESET_PLL_SYS | RESET_PLL_USB;
+        sysHz = XOSC_HZ;
+        clocks->clk[CLK_SYS].div = CLK_DIV_INT(1);
+
+        auxClockStop(CLK_USB);
+        auxClockStop(CLK_ADC);
+        auxClockStart(CLK_RTC, CLK_USB_AUX_XOSC, XOSC_HZ / RTC_CLK_HZ, RTC_CLK_HZ);
+    } else {
+        /* 4b. PLL_SYS: 1500 MHz VCO / 6 / 2 = 125 MHz
+               or 1596 MHz VCO / 6 / 2 = 133 MHz
+               PLL_USB: 1200 MHz VCO / 5 / 5 = 48 MHz */
+        if (profile == CLOCK_PROFILE_133MHZ) {
+            pllStart(pll_sys, RESET_PLL_SYS, 133, 6, 2);
+            sysHz = 133000000U;
+        } else {
+            pllStart(pll_sys, RESET_PLL_SYS, 125, 6, 2);
+            sysHz = 125000000U;
+        }
+        pllStart(pll_usb, RESET_PLL_USB, 100, 5, 5);
+
+        /* Select PLL_SYS on the aux mux while clk_sys still runs from
+           clk_ref, then flip the glitchless mux over to aux */
+        clocks->clk[CLK_SYS].div = CLK_DIV_INT(1);
+        clocks->clk[CLK_SYS].ctrl = CLK_CTRL_AUXSRC(CLK_SYS_AUX_PLL_SYS);
+        clocks->clk[CLK_SYS].ctrl |= CLK_SYS_SRC_AUX;
+        while (clocks->clk[CLK_SYS].selected != (1U << CLK_SYS_SRC_AUX)) {}
+
+        auxClockStart(CLK_USB, CLK_USB_AUX_PLL_USB, 1, 48000000U);
+        auxClockStart(CLK_ADC, CLK_USB_AUX_PLL_USB, 1, 48000000U);
+        auxClockStart(CLK_RTC, CLK_USB_AUX_PLL_USB, 48000000U / RTC_CLK_HZ, RTC_CLK_HZ);
+    }
+    clockHz[CLK_SYS] = sysHz;
+
+    /* 5. clk_peri (UART, SPI) follows clk_sys */
+    auxClockStart(CLK_PERI, CLK_PERI_AUX_CLK_SYS, 0, sysHz);
+
+    /* 6. 1 us TIMER tick from the 12 MHz clk_ref */
+    WATCHDOG_TICK = WATCHDOG_TICK_ENABLE | (XOSC_HZ / 1000000U);
+}
+
+uint32_t clockGetHz(enum clockId id)
+{
+    return clockHz[id];
+}
@@ -0,0 +1,60 @@
+/* Clock Initialization
+ * Starts the 12 MHz crystal oscillator, locks the PLLs and moves the
+ * clock generators off the ring oscillator so that every timing in the
+ * firmware is derived from the crystal */
+
+#ifndef CLOCKS_H
+#define CLOCKS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Crystal frequency fitted to the board */
+#define XOSC_HZ 12000000U
+
+/* clk_rtc runs at 46875 Hz in every profile, so the RTC's 1 Hz divider
+ * stays an integer */
+#define RTC_CLK_HZ 46875U
+
+/* Clock generators, in register order */
+enum clockId {
+    CLK_GPOUT0 = 0,
+    CLK_GPOUT1,
+    CLK_GPOUT2,
+    CLK_GPOUT3,
+    CLK_REF,
+    CLK_SYS,
+    CLK_PERI,
+    CLK_USB,
+    CLK_ADC,
+    CLK_RTC,
+    CLK_COUNT
+};
+
+/* Clock profiles
+ * CLOCK_PROFILE_125MHZ: PLL_SYS at 125 MHz, PLL_USB at 48 MHz
+ * CLOCK_PROFILE_133MHZ: PLL_SYS at 133 MHz, PLL_USB at 48 MHz
+ * CLOCK_PROFILE_XOSC: everything on the 12 MHz crystal, both PLLs off,
+ *                     no USB or ADC clock (battery builds) */
+enum clockProfile {
+    CLOCK_PROFILE_125MHZ = 0,
+    CLOCK_PROFILE_133MHZ,
+    CLOCK_PROFILE_XOSC
+};
+
+/* Bring up XOSC, PLLs and clock generators for the given profile
+ * Also starts the 1 us watchdog tick that clocks the TIMER
+ * Must run before any peripheral that depends on clk_peri or the TIMER */
+void clocksInit(enum clockProfile profile);
+
+/* Frequency of a clock generator in Hz, 0 if it is stopped */
+uint32_t clockGetHz(enum clockId id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCKS_H */
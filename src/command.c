@@ -0,0 +1,172 @@
+/* Host Setting Commands
+ * commandNextChar() runs from the keying engine's interrupt and only
+ * collects the line. Parsing waits for commandTake() in thread mode. The
+ * line buffer has one writer at a time: the interrupt until it raises
+ * linePending, commandTake() until it clears it */
+
+#include "rp2040.h"
+#include "ring.h"
+#include "command.h"
+
+#define NUMBER_DIGITS_MAX 9     /* Anything longer cannot be a setting */
+
+static morseCharSource rawSource;
+static char line[COMMAND_LINE_MAX];
+static uint32_t lineLength;         /* Beyond COMMAND_LINE_MAX if it overflowed */
+static bool lineStart = true;       /* Next character starts a line */
+static bool inCommand;
+static volatile bool linePending;
+
+void commandSource(morseCharSource source)
+{
+    uint32_t primask = irqDisable();
+    rawSource = source;
+    lineLength = 0;
+    lineStart = true;
+    inCommand = false;
+    linePending = false;
+    irqRestore(primask);
+}
+
+bool __not_in_flash_func(commandNextChar)(char *c)
+{
+    char next;
+
+    while (!linePending && rawSource != 0 && rawSource(&next)) {
+        bool lineEnd = next == '\r' || next == '\n';
+
+        if (inCommand) {
+            if (lineEnd) {
+                inCommand = false;
+                lineStart = true;
+                ringBarrier();      /* The line before the flag */
+                linePending = true;
+                return false;
+            }
+            if (lineLength < COMMAND_LINE_MAX) {
+                line[lineLength] = next;
+            }
+            if (lineLength <= COMMAND_LINE_MAX) {
+                lineLength++;
+            }
+            continue;
+        }
+        if (lineStart && next == COMMAND_START) {
+            inCommand = true;
+            lineLength = 0;
+            continue;
+        }
+        lineStart = lineEnd;
+        *c = next;
+        return true;
+    }
+    return false;
+}
+
+static char upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+/* Skip word at *at, any case, followed by a space or the end */
+static bool matchWord(uint32_t *at, const char *word)
+{
+    uint32_t i = *at;
+
+    while (*word != 0) {
+        if (i == lineLength || upper(line[i]) != *word) {
+            return false;
+        }
+        i++;
+        word++;
+    }
+    if (i != lineLength && line[i] != ' ') {
+        return false;
+    }
+    *at = i;
+    return true;
+}
+
+static void skipSpaces(uint32_t *at)
+{
+    while (*at < lineLength && line[*at] == ' ') {
+        (*at)++;
+    }
+}
+
+/* Decimal number at *at and nothing but spaces after it */
+static bool parseNumber(uint32_t at, uint32_t *value)
+{
+    uint32_t digits = 0;
+    uint32_t number = 0;
+
+    skipSpaces(&at);
+    while (at < lineLength && line[at] >= '0' && line[at] <= '9') {
+        if (++digits > NUMBER_DIGITS_MAX) {
+            return false;
+        }
+        number = number * 10 + (uint32_t)(line[at++] - '0');
+    }
+    skipSpaces(&at);
+    *value = number;
+    return digits != 0 && at == lineLength;
+}
+
+/* Channel letter, then the text after one space as sent */
+static bool parseBeacon(uint32_t at, struct command *command)
+{
+    skipSpaces(&at);
+    if (at == lineLength) {
+        return false;
+    }
+    char channel = upper(line[at++]);
+    if (channel < 'A' || channel > 'Z' || (at != lineLength && line[at] != ' ')) {
+        return false;
+    }
+    command->value = (uint32_t)(channel - 'A');
+
+    command->length = 0;
+    for (at++; at < lineLength; at++) {
+        command->text[command->length++] = line[at];
+    }
+    command->text[command->length] = '\0';
+    return true;
+}
+
+bool commandTake(struct command *command)
+{
+    if (!linePending) {
+        return false;
+    }
+    ringBarrier();      /* The flag before the line */
+
+    uint32_t at = 0;
+    bool valid = false;
+
+    command->id = COMMAND_INVALID;
+    command->value = 0;
+    command->length = 0;
+    command->text[0] = '\0';
+    if (lineLength > COMMAND_LINE_MAX) {
+        /* Cut off, whatever it was */
+    } else if (matchWord(&at, "WPM")) {
+        command->id = COMMAND_WPM;
+        valid = parseNumber(at, &command->value);
+    } else if (matchWord(&at, "TONE")) {
+        command->id = COMMAND_TONE;
+        valid = parseNumber(at, &command->value);
+    } else if (matchWord(&at, "BEACON")) {
+        command->id = COMMAND_BEACON;
+        valid = parseBeacon(at, command);
+    }
+    if (!valid) {
+        command->id = COMMAND_INVALID;
+        command->value = 0;
+        command->length = 0;
+        command->text[0] = '\0';
+    }
+
+    ringBarrier();      /* Done with the line before handing it back */
+    linePending = false;
+    return true;
+}
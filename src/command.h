@@ -0,0 +1,65 @@
+/* Host Setting Commands
+ * A line from the USB or UART host that starts with a backslash, which
+ * has no Morse code, sets a value in the flash store instead of being
+ * keyed:
+ *   \WPM 25          sending speed
+ *   \TONE 700        sidetone frequency in Hz
+ *   \BEACON A text   beacon text of channel A, B and so on. Without a
+ *                    text the channel goes back to its default
+ * Words and the channel letter may be lower case, the text is kept as
+ * sent.
+ *
+ * commandNextChar() sits between the port and the encoder and passes
+ * every other line through. Once a command line is complete it returns
+ * nothing until the main loop has taken the command with commandTake(),
+ * so text after a command is only keyed with the new setting in place.
+ * The main loop then restarts whatever pulls from commandNextChar() */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "morse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Marks a command line when it is the first character */
+#define COMMAND_START '\\'
+
+/* Longest command line, the backslash and line end not counted */
+#define COMMAND_LINE_MAX 56
+
+enum commandId {
+    COMMAND_INVALID,    /* Unknown word, malformed or too long */
+    COMMAND_WPM,
+    COMMAND_TONE,
+    COMMAND_BEACON
+};
+
+struct command {
+    enum commandId id;
+    uint32_t value;     /* WPM and TONE: the number, BEACON: the channel */
+    uint32_t length;    /* BEACON: characters of text, 0 for the default */
+    char text[COMMAND_LINE_MAX + 1];    /* BEACON: the text, terminated */
+};
+
+/* Read characters from source from now on */
+void commandSource(morseCharSource source);
+
+/* Next character for the encoder, false while none is waiting or a
+ * command waits for commandTake(). Matches morseCharSource */
+bool commandNextChar(char *c);
+
+/* Take the command line that stopped commandNextChar(), returns false if
+ * there is none. Call from one place only, e.g. the main loop */
+bool commandTake(struct command *command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMAND_H */
@@ -0,0 +1,188 @@
+/* Switch Debounce
+ * A switch is either armed (edge interrupts enabled) or locked out until
+ * its deadline. The alarm always targets the earliest pending deadline */
+
+#include "rp2040.h"
+#include "debounce.h"
+
+/* Alarm used for the lockout windows, one of TIMER alarms 0-3 */
+#define DEBOUNCE_ALARM 2
+
+/* Both edge events of one pin in its proc0_inte / intr nibble */
+#define PIN_EDGES(pin) \
+    ((uint32_t)(GPIO_INT_EDGE_LOW | GPIO_INT_EDGE_HIGH) << (4 * ((pin) % 8)))
+
+struct debounceSwitch {
+    uint32_t pin;
+    uint32_t lockoutUs;
+    uint32_t deadline;          /* End of the lockout window */
+    bool activeLow;
+    bool locked;                /* Edge interrupts masked until deadline */
+    bool down;                  /* Last reported state */
+    debounceHandler handler;
+};
+
+static struct debounceSwitch switches[DEBOUNCE_MAX_SWITCHES];
+static uint32_t switchCount;
+
+static inline bool __not_in_flash_func(sample)(const struct debounceSwitch *s)
+{
+    bool high = (sio->gpio_in >> s->pin) & 1U;
+    return high != s->activeLow;
+}
+
+/* Arm the alarm for the earliest lockout deadline, forcing it if that
+ * deadline has already passed */
+static void __not_in_flash_func(armAlarm)(void)
+{
+    uint32_t now = timer->timerawl;
+    uint32_t earliest = 0;
+    bool any = false;
+
+    for (uint32_t i = 0; i < switchCount; i++) {
+        if (switches[i].locked &&
+            (!any || (int32_t)(switches[i].deadline - earliest) < 0)) {
+            earliest = switches[i].deadline;
+            any = true;
+        }
+    }
+
+    if (any) {
+        timer->alarm[DEBOUNCE_ALARM] = earliest;
+        if ((int32_t)(earliest - now) <= 0) {
+            timer->intf |= 1U << DEBOUNCE_ALARM;
+        }
+    }
+}
+
+/* Report a clean edge and start the lockout window */
+static void __not_in_flash_func(report)(struct debounceSwitch *s, uint32_t now, bool down)
+{
+    s->down = down;
+    s->locked = true;
+    s->deadline = now + s->lockoutUs;
+    s->handler(now, down);
+}
+
+/* Close the lockout window of a switch
+ * Latched edges are cleared before the pin is sampled, so any edge after
+ * the sample raises a fresh interrupt once the switch is unmasked. A
+ * switch that settled in a new state is reported and locked again */
+static void __not_in_flash_func(settle)(struct debounceSwitch *s, uint32_t now)
+{
+    io->intr[s->pin / 8] = PIN_EDGES(s->pin);
+
+    bool down = sample(s);
+    if (down != s->down) {
+        report(s, now, down);
+    } else {
+        s->locked = false;
+        io->proc0_inte[s->pin / 8] |= PIN_EDGES(s->pin);
+    }
+}
+
+void debounceInit(void)
+{
+    RESETS_RESET &= ~RESET_TIMER;
+    while ((RESETS_RESET_DONE & RESET_TIMER) == 0) {}
+
+    timer->intr = 1U << DEBOUNCE_ALARM;
+    timer->inte |= 1U << DEBOUNCE_ALARM;
+    NVIC_ISER = 1U << (TIMER_IRQ_0 + DEBOUNCE_ALARM);
+}
+
+bool debounceAdd(uint32_t pin, uint32_t lockoutUs, bool activeLow,
+                 debounceHandler handler)
+{
+    if (switchCount == DEBOUNCE_MAX_SWITCHES) {
+        return false;
+    }
+
+    struct debounceSwitch *s = &switches[switchCount];
+    s->pin = pin;
+    s->lockoutUs = lockoutUs;
+    s->activeLow = activeLow;
+    s->handler = handler;
+    s->down = sample(s);
+    switchCount++;
+
+    settle(s, timer->timerawl);
+    return true;
+}
+
+bool debounceIdle(void)
+{
+    for (uint32_t i = 0; i < switchCount; i++) {
+        if (switches[i].locked || sample(&switches[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void debounceResample(void)
+{
+    uint32_t primask = irqDisable();
+    uint32_t now = timer->timerawl;
+
+    for (uint32_t i = 0; i < switchCount; i++) {
+        if (!switches[i].locked) {
+            io->proc0_inte[switches[i].pin / 8] &= ~PIN_EDGES(switches[i].pin);
+            switches[i].locked = true;
+            settle(&switches[i], now);
+        }
+    }
+    armAlarm();
+    irqRestore(primask);
+}
+
+bool __not_in_flash_func(debounceIrq)(void)
+{
+    uint32_t now = timer->timerawl;
+    bool handled = false;
+
+    for (uint32_t i = 0; i < switchCount; i++) {
+        struct debounceSwitch *s = &switches[i];
+
+        if (io->proc0_ints[s->pin / 8] & PIN_EDGES(s->pin)) {
+            /* Mask the bounces that follow, the alarm takes over */
+            io->proc0_inte[s->pin / 8] &= ~PIN_EDGES(s->pin);
+            io->intr[s->pin / 8] = PIN_EDGES(s->pin);
+
+            bool down = sample(s);
+            if (down != s->down) {
+                report(s, now, down);
+            } else {
+                /* Already bounced back, wait one window before trusting it */
+                s->locked = true;
+                s->deadline = now + s->lockoutUs;
+            }
+            handled = true;
+        }
+    }
+
+    if (handled) {
+        armAlarm();
+    }
+    return handled;
+}
+
+/* Interrupt handler for TIMER alarm 2
+ * Overrides the weak alias in startup.c. Closes expired lockout windows */
+void __not_in_flash_func(timerIrq2)(void)
+{
+    timer->intf &= ~(1U << DEBOUNCE_ALARM);
+    timer->intr = 1U << DEBOUNCE_ALARM;
+
+    uint32_t now = timer->timerawl;
+
+    for (uint32_t i = 0; i < switchCount; i++) {
+        struct debounceSwitch *s = &switches[i];
+
+        if (s->locked && (int32_t)(s->deadline - now) <= 0) {
+            settle(s, now);
+        }
+    }
+
+    armAlarm();
+}
@@ -0,0 +1,59 @@
+/* Switch Debounce
+ * Leading-edge debounce with a TIMER lockout window per switch. The first
+ * edge is reported at once with its exact timestamp, then the switch's
+ * edge interrupts are masked for its lockout time and TIMER alarm 2
+ * re-samples the pin when the window closes. Bounces never reach the CPU,
+ * so nothing runs between edges.
+ *
+ * Handlers run from the GPIO or the alarm interrupt. Both sit at the
+ * default priority and never preempt each other, so a handler may be the
+ * single producer of a ring */
+
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of switches that can be registered */
+#define DEBOUNCE_MAX_SWITCHES 4
+
+/* Typical lockout windows: contact bounce on mechanical paddles and keys
+   settles within a few milliseconds, optical keys hardly bounce at all */
+#define DEBOUNCE_MECHANICAL_US 5000
+#define DEBOUNCE_OPTICAL_US 200
+
+/* Called with the time of the clean edge and the new switch state */
+typedef void (*debounceHandler)(uint32_t timestampUs, bool down);
+
+/* Release TIMER from reset and claim alarm 2 */
+void debounceInit(void);
+
+/* Watch pin, which must already be configured as an input
+ * lockoutUs ignores further edges for that long after each reported edge,
+ * activeLow selects a switch that pulls the pin low when closed. Enables
+ * both edge interrupts for the pin. Returns false if all slots are used */
+bool debounceAdd(uint32_t pin, uint32_t lockoutUs, bool activeLow,
+                 debounceHandler handler);
+
+/* True when no switch is inside its lockout window or closed, read from
+ * the pin as it is now */
+bool debounceIdle(void);
+
+/* Report any switch whose state changed without an interrupt, such as an
+ * edge that woke the chip from DORMANT. Call with the switches armed */
+void debounceResample(void);
+
+/* Handle GPIO edges of the registered switches
+ * Call from ioIrqBank0(), returns true if one of them was pending */
+bool debounceIrq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEBOUNCE_H */
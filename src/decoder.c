@@ -0,0 +1,182 @@
+/* Straight-Key Decoder
+ * Letters are collected in the same packed format as morseTable (first
+ * element in bit 0, 1 = dah) and looked up in a reverse table indexed by
+ * (1 << count) | elements, built once from morseTable at init */
+
+#include "rp2040.h"
+#include "ring.h"
+#include "morse.h"
+#include "decoder.h"
+
+/* Alarm used to finish letters and words while the key stays up */
+#define DECODER_ALARM 1
+
+/* Longest letter the reverse table covers */
+#define DECODER_MAX_ELEMENTS 7
+
+/* Limits for the adaptive dit length (about 60 WPM down to 3 WPM) */
+#define DECODER_DIT_MIN_US 20000U
+#define DECODER_DIT_MAX_US 400000U
+
+/* Producer: the GPIO interrupt, consumer: decoderPoll() */
+RING_DEFINE(edgeRing, DECODER_EDGE_RING_SIZE);
+/* Producer: decoderPoll(), consumer: decoderGetChar() */
+RING_DEFINE(textRing, DECODER_TEXT_RING_SIZE);
+
+/* Code to character, index (1 << count) | elements */
+static char reverseTable[2 << DECODER_MAX_ELEMENTS];
+
+static uint32_t ditUs;              /* Running dit length estimate */
+static uint32_t lastEdgeUs;         /* Time of the last processed edge */
+static bool keyDown;                /* Key state after the last edge */
+static uint32_t letterElements;     /* Elements of the letter in progress */
+static uint32_t letterCount;
+static bool wordPending;            /* A letter ended, word gap undecided */
+
+void decoderInit(uint32_t wpm)
+{
+    for (uint32_t c = 0; c < 128; c++) {
+        uint32_t count = MORSE_COUNT(morseTable[c]);
+        /* Upper case wins over the identical lower case entries */
+        if (count != 0 && count <= DECODER_MAX_ELEMENTS && !(c >= 'a' && c <= 'z')) {
+            reverseTable[(1U << count) | MORSE_ELEMENTS(morseTable[c])] = (char)c;
+        }
+    }
+
+    ditUs = morseDitUs(wpm);
+    keyDown = false;
+    letterElements = 0;
+    letterCount = 0;
+    wordPending = false;
+    ringFlush(&edgeRing);
+
+    /* The scheduler may not own the timer in every build */
+    RESETS_RESET &= ~RESET_TIMER;
+    while ((RESETS_RESET_DONE & RESET_TIMER) == 0) {}
+
+    lastEdgeUs = timer->timerawl;
+    timer->intr = 1U << DECODER_ALARM;
+    timer->inte |= 1U << DECODER_ALARM;
+    NVIC_ISER = 1U << (TIMER_IRQ_0 + DECODER_ALARM);
+}
+
+bool __not_in_flash_func(decoderEdge)(uint32_t timestampUs, bool down)
+{
+    return ringPush(&edgeRing, DECODER_EDGE(timestampUs, down));
+}
+
+/* Interrupt handler for TIMER alarm 1
+ * Overrides the weak alias in startup.c. Only wakes the core, the gap is
+ * evaluated by decoderPoll() */
+void __not_in_flash_func(timerIrq1)(void)
+{
+    timer->intf &= ~(1U << DECODER_ALARM);
+    timer->intr = 1U << DECODER_ALARM;
+}
+
+static void emit(char c)
+{
+    ringPush(&textRing, (uint8_t)c);
+}
+
+/* Finish the letter and word that a key-up gap of gapUs covers */
+static void closeGap(uint32_t gapUs)
+{
+    if (letterCount != 0 && gapUs >= 2 * ditUs) {
+        char c = letterCount <= DECODER_MAX_ELEMENTS ?
+                 reverseTable[(1U << letterCount) | letterElements] : 0;
+        emit(c != 0 ? c : '?');
+        letterElements = 0;
+        letterCount = 0;
+        wordPending = true;
+    }
+    if (wordPending && gapUs >= 5 * ditUs) {
+        emit(' ');
+        wordPending = false;
+    }
+}
+
+/* Wake up again when the current gap reaches the next boundary
+ * Forces the interrupt if that moment already passed, as in scheduler.c */
+static void armGapAlarm(void)
+{
+    uint32_t deadline = lastEdgeUs + (letterCount != 0 ? 2 * ditUs : 5 * ditUs);
+
+    timer->alarm[DECODER_ALARM] = deadline;
+    if ((int32_t)(deadline - timer->timerawl) <= 0) {
+        timer->intf |= 1U << DECODER_ALARM;
+    }
+}
+
+/* Classify one key-down period and adapt the dit estimate */
+static void addElement(uint32_t lengthUs)
+{
+    uint32_t dah = lengthUs >= 2 * ditUs;
+    /* A dah counts as three dits, 85 / 256 is close enough to 1 / 3 */
+    uint32_t sample = dah ? (lengthUs * 85) >> 8 : lengthUs;
+
+    ditUs = (3 * ditUs + sample) >> 2;
+    if (ditUs < DECODER_DIT_MIN_US) {
+        ditUs = DECODER_DIT_MIN_US;
+    } else if (ditUs > DECODER_DIT_MAX_US) {
+        ditUs = DECODER_DIT_MAX_US;
+    }
+
+    if (letterCount < 8) {
+        letterElements |= dah << letterCount;
+    }
+    letterCount++;
+}
+
+void decoderPoll(void)
+{
+    uint32_t edge;
+
+    while (ringPop(&edgeRing, &edge)) {
+        bool down = (edge & 1U) != 0;
+        uint32_t timestamp = edge & ~1U;
+        uint32_t elapsed = timestamp - lastEdgeUs;
+
+        if (down == keyDown) {
+            continue;   /* Repeated state, nothing to measure */
+        }
+        lastEdgeUs = timestamp;
+        keyDown = down;
+
+        if (down) {
+            closeGap(elapsed);
+            wordPending = false;
+        } else {
+            addElement(elapsed);
+        }
+    }
+
+    /* Key up: finish what the gap so far already decides */
+    if (!keyDown && (letterCount != 0 || wordPending)) {
+        closeGap(timer->timerawl - lastEdgeUs);
+        if (letterCount != 0 || wordPending) {
+            armGapAlarm();
+        }
+    }
+}
+
+bool decoderIdle(void)
+{
+    return ringEmpty(&edgeRing) && !keyDown && letterCount == 0 && !wordPending;
+}
+
+bool decoderGetChar(char *c)
+{
+    uint32_t value;
+
+    if (!ringPop(&textRing, &value)) {
+        return false;
+    }
+    *c = (char)value;
+    return true;
+}
+
+uint32_t decoderWpm(void)
+{
+    return hwDivide(1200000U, ditUs);
+}
@@ -0,0 +1,55 @@
+/* Straight-Key Decoder
+ * Turns timestamped key edges into text. The edge interrupt only records
+ * (timestamp, state) pairs in a ring; decoderPoll() classifies them later
+ * from thread mode, so no edge is lost even at high speed.
+ *
+ * Elements shorter than two dits are dits, longer ones dahs. Gaps of two
+ * dits or more end a letter and gaps of five dits or more end a word (the
+ * midpoints between the nominal 1, 3 and 7 unit gaps). The dit length
+ * follows the operator's speed with a running average */
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Edge entry format: TIMER microseconds with bit 0 replaced by the key
+ * state (1 = down), so one ring entry holds a whole edge */
+#define DECODER_EDGE(timestampUs, down) (((timestampUs) & ~1U) | ((down) ? 1U : 0U))
+
+/* Number of edges and decoded characters buffered */
+#define DECODER_EDGE_RING_SIZE 64
+#define DECODER_TEXT_RING_SIZE 64
+
+/* Reset decoder state with an initial speed estimate
+ * Builds the code to character table and claims TIMER alarm 1, which
+ * wakes the core to finish a letter once the key stays up */
+void decoderInit(uint32_t wpm);
+
+/* Record one edge, called from a debounce handler (debounce.h)
+ * Returns false if the edge ring overflowed */
+bool decoderEdge(uint32_t timestampUs, bool down);
+
+/* Classify pending edges and finish letters and words whose gap has
+ * expired. Call from thread mode after every wake up */
+void decoderPoll(void);
+
+/* True when no edge is waiting and no letter or word is open */
+bool decoderIdle(void);
+
+/* Take the next decoded character, returns false if none */
+bool decoderGetChar(char *c);
+
+/* Current speed estimate in words per minute */
+uint32_t decoderWpm(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DECODER_H */
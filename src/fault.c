@@ -0,0 +1,119 @@
+/* Fault Capture and Watchdog
+ * The record is sealed with a check word over everything before it, so
+ * whatever SRAM holds after a power-on never reads as a fault. It is only
+ * believed after a reset the watchdog was forced into, and cleared once
+ * read, so every fault is reported by exactly one boot.
+ *
+ * faultCapture() runs from SRAM and calls nothing in flash, so it does
+ * not depend on the code that faulted having left XIP working. The stack
+ * pointer only has to be good enough to run on, the frame is read only
+ * if it lies within SRAM */
+
+#include "rp2040.h"
+#include "instrument.h"
+#include "fault.h"
+
+#define FRAME_WORDS 8               /* r0-r3, r12, LR, PC, xPSR */
+#define SCRATCH_RESETS 0            /* Watchdog scratch register counting resets */
+#define RECORD_WORDS (sizeof(struct faultReport) / 4 - 1)    /* Up to check */
+
+/* Survives the watchdog reset, volatile so no access is left out */
+static volatile struct faultReport faultRecord __attribute__((section(".noinit.faultRecord")));
+
+struct faultReport faultReport;
+uint32_t watchdogLoad;
+
+static uint32_t __not_in_flash_func(recordCheck)(const volatile struct faultReport *r)
+{
+    const volatile uint32_t *word = (const volatile uint32_t *)r;
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < RECORD_WORDS; i++) {
+        sum = ((sum << 5) | (sum >> 27)) ^ word[i];
+    }
+    return ~sum;
+}
+
+void faultInit(void)
+{
+    uint32_t reason = WATCHDOG_REASON;
+
+    WATCHDOG_CTRL = 0;
+    PSM_WDSEL = PSM_WDSEL_ALL & ~(PSM_WDSEL_ROSC | PSM_WDSEL_XOSC);
+
+    /* Scratch registers are only cleared by the resets REASON ignores */
+    uint32_t resets = reason == 0 ? 0 : WATCHDOG_SCRATCH(SCRATCH_RESETS) + 1;
+    WATCHDOG_SCRATCH(SCRATCH_RESETS) = resets;
+
+    if ((reason & WATCHDOG_REASON_FORCE) != 0 && faultRecord.magic == FAULT_MAGIC &&
+        faultRecord.check == recordCheck(&faultRecord)) {
+        const volatile uint32_t *from = (const volatile uint32_t *)&faultRecord;
+        uint32_t *to = (uint32_t *)&faultReport;
+        for (uint32_t i = 0; i < RECORD_WORDS; i++) {
+            to[i] = from[i];
+        }
+    } else if ((reason & WATCHDOG_REASON_TIMER) != 0) {
+        faultReport.cause = FAULT_TIMEOUT;
+    }
+    faultReport.resets = resets;
+    faultRecord.magic = 0;
+}
+
+void __not_in_flash_func(faultCapture)(const uint32_t *frame, uint32_t excReturn)
+{
+    volatile struct faultReport *r = &faultRecord;
+    uint32_t ipsr;
+    uint32_t core = sio->cpuid;
+
+    __asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+
+    r->cause = FAULT_EXCEPTION;
+    r->resets = 0;
+    r->exception = ipsr & 0x3f;
+    r->core = core;
+    r->excReturn = excReturn;
+
+    uint32_t at = (uint32_t)frame;
+    bool readable = (at & 3) == 0 && at >= SRAM_BASE && at <= SRAM_END - 4 * FRAME_WORDS;
+    r->sp = readable ? at : 0;
+    r->r0 = readable ? frame[0] : 0;
+    r->r1 = readable ? frame[1] : 0;
+    r->r2 = readable ? frame[2] : 0;
+    r->r3 = readable ? frame[3] : 0;
+    r->r12 = readable ? frame[4] : 0;
+    r->lr = readable ? frame[5] : 0;
+    r->pc = readable ? frame[6] : 0;
+    r->xpsr = readable ? frame[7] : 0;
+
+    for (uint32_t n = 0; n < INSTR_RECENT; n++) {
+#if defined(INSTRUMENT)
+        uint32_t slot = (instrumentStats.recentNext[core] + n) & (INSTR_RECENT - 1);
+        r->recent[n].id = instrumentStats.recent[core][slot].id;
+        r->recent[n].value = instrumentStats.recent[core][slot].value;
+#else
+        r->recent[n].id = INSTR_COUNT;
+        r->recent[n].value = 0;
+#endif
+    }
+
+    r->magic = FAULT_MAGIC;
+    r->check = recordCheck(r);
+
+    /* Reset now, everything but the oscillators */
+    PSM_WDSEL = PSM_WDSEL_ALL & ~(PSM_WDSEL_ROSC | PSM_WDSEL_XOSC);
+    WATCHDOG_CTRL = WATCHDOG_CTRL_TRIGGER;
+    while (true) {}
+}
+
+void watchdogStart(uint32_t timeoutMs)
+{
+    if (timeoutMs > WATCHDOG_TIMEOUT_MAX_MS) {
+        timeoutMs = WATCHDOG_TIMEOUT_MAX_MS;
+    }
+    watchdogLoad = timeoutMs * 2000;    /* RP2040-E1: 2 counts per us */
+
+    WATCHDOG_CTRL = 0;
+    WATCHDOG_LOAD = watchdogLoad;
+    WATCHDOG_CTRL = WATCHDOG_CTRL_ENABLE | WATCHDOG_CTRL_PAUSE_JTAG |
+                    WATCHDOG_CTRL_PAUSE_DBG0 | WATCHDOG_CTRL_PAUSE_DBG1;
+}
@@ -0,0 +1,105 @@
+/* Fault Capture and Watchdog
+ * Any exception without a handler of its own, HardFault first of all,
+ * ends in faultCapture() instead of hanging:
+ * 1. The registers the core stacked on entry (r0-r3, r12, LR, PC, xPSR),
+ *    the exception number and the faulting core's last instrumentation
+ *    samples go into a record in .noinit, which resetHandler leaves alone
+ * 2. The watchdog resets the chip at once
+ * 3. faultInit() on the next boot finds the record and moves it into
+ *    faultReport, where it stays until the reset after that
+ *
+ * The watchdog also runs on its own once watchdogStart() is called, and
+ * resets the chip unless watchdogFeed() comes within the timeout. The
+ * next boot reports that as FAULT_TIMEOUT, without registers since no
+ * code ran to save them. A core that sleeps for longer pauses it with
+ * watchdogPause() instead of waking up to feed it.
+ *
+ * faultReport is a fixed RAM block like instrumentStats, e.g.
+ *   (gdb) print/x faultReport
+ * and USB builds add it to the status report */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "instrument.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest timeout the 24-bit counter holds at 2 counts per us */
+#define WATCHDOG_TIMEOUT_MAX_MS 8388
+
+enum faultCause {
+    FAULT_NONE,         /* The last reset was not the watchdog's */
+    FAULT_EXCEPTION,    /* faultCapture() saved the registers below */
+    FAULT_TIMEOUT       /* The watchdog ran out */
+};
+
+/* "FALT" while a record in .noinit waits for the next boot */
+#define FAULT_MAGIC 0x544c4146
+
+struct faultReport {
+    uint32_t magic;
+    uint32_t cause;         /* enum faultCause */
+    uint32_t resets;        /* Watchdog resets since power-on, this one included */
+    uint32_t exception;     /* IPSR: 2 NMI, 3 HardFault, 16 + n interrupt n */
+    uint32_t core;
+    uint32_t excReturn;     /* LR on entry, which stack and mode */
+    uint32_t sp;            /* Address of the stacked frame, 0 if unreadable */
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;            /* Instruction that faulted, or was next */
+    uint32_t xpsr;
+    struct instrSample recent[INSTR_RECENT];    /* Oldest first, INSTRUMENT builds */
+    uint32_t check;
+};
+
+extern struct faultReport faultReport;
+
+/* Word the watchdog is reloaded with, set by watchdogStart() */
+extern uint32_t watchdogLoad;
+
+/* Call first in main: stops a watchdog left running, selects what it
+ * resets and fills faultReport from the reset that just happened */
+void faultInit(void);
+
+/* Save the exception frame at frame, as described above, and reset.
+ * Called by defaultHandler in startup.c with EXC_RETURN */
+__attribute__((noreturn)) void faultCapture(const uint32_t *frame, uint32_t excReturn);
+
+/* Reset unless fed at least every timeoutMs, up to
+ * WATCHDOG_TIMEOUT_MAX_MS. Paused while a debugger halts a core */
+void watchdogStart(uint32_t timeoutMs);
+
+static inline void watchdogFeed(void)
+{
+    WATCHDOG_LOAD = watchdogLoad;
+}
+
+/* Stop the countdown while the core sleeps, with interrupts masked so
+ * no handler runs unwatched. watchdogResume() reloads and restarts it
+ * before they are unmasked again */
+static inline void watchdogPause(void)
+{
+    WATCHDOG_CTRL &= ~WATCHDOG_CTRL_ENABLE;
+}
+
+static inline void watchdogResume(void)
+{
+    WATCHDOG_LOAD = watchdogLoad;
+    WATCHDOG_CTRL |= WATCHDOG_CTRL_ENABLE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAULT_H */
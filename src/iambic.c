@@ -0,0 +1,130 @@
+/* Iambic Paddle Keyer
+ * Every element is returned to the scheduler as a key down symbol followed
+ * by a one unit space. The next element is only decided once that space
+ * has run out, from the paddles held at that moment and the memories
+ * latched while the element was sent */
+
+#include "rp2040.h"
+#include "scheduler.h"
+#include "debounce.h"
+#include "morse.h"
+#include "iambic.h"
+
+enum element {
+    ELEMENT_NONE,
+    ELEMENT_DIT,
+    ELEMENT_DAH
+};
+
+static enum iambicMode keyerMode;
+static volatile bool ditDown;           /* Paddle states from the debouncer */
+static volatile bool dahDown;
+static volatile bool ditMemory;         /* Pressed during a dah */
+static volatile bool dahMemory;         /* Pressed during a dit */
+static volatile enum element sending;   /* Element or its space being keyed */
+static bool spacePending;               /* Element sent, its space is next */
+
+/* Scheduler source, called from the TIMER alarm 0 interrupt */
+static uint8_t __not_in_flash_func(iambicSource)(void)
+{
+    if (spacePending) {
+        spacePending = false;
+        return SYMBOL_UP(MORSE_ELEMENT_GAP);
+    }
+
+    /* Choose the next element:
+       1. Both paddles wanted: alternate with the element just sent
+       2. One paddle wanted: repeat its element
+       3. Neither: stop, the scheduler goes idle until the next press */
+    bool wantDit = ditDown || ditMemory;
+    bool wantDah = dahDown || dahMemory;
+    enum element next;
+
+    if (wantDit && wantDah) {
+        next = (sending == ELEMENT_DIT) ? ELEMENT_DAH : ELEMENT_DIT;
+    } else if (wantDit) {
+        next = ELEMENT_DIT;
+    } else if (wantDah) {
+        next = ELEMENT_DAH;
+    } else {
+        sending = ELEMENT_NONE;
+        return 0;
+    }
+
+    /* Consume the memory of the element sent now. In Mode B an opposite
+       paddle that is already held counts as a press during this element */
+    if (next == ELEMENT_DIT) {
+        ditMemory = false;
+        if (keyerMode == IAMBIC_MODE_B && dahDown) {
+            dahMemory = true;
+        }
+    } else {
+        dahMemory = false;
+        if (keyerMode == IAMBIC_MODE_B && ditDown) {
+            ditMemory = true;
+        }
+    }
+
+    sending = next;
+    spacePending = true;
+    return SYMBOL_DOWN(next == ELEMENT_DIT ? 1 : 3);
+}
+
+/* Debounced paddle edges
+ * A press while the other element is being sent is latched in its memory,
+ * a press while idle starts the scheduler */
+static void __not_in_flash_func(ditEdge)(uint32_t timestampUs, bool down)
+{
+    (void)timestampUs;
+    ditDown = down;
+    if (down) {
+        if (sending == ELEMENT_DAH) {
+            ditMemory = true;
+        }
+        schedulerStart();
+    }
+}
+
+static void __not_in_flash_func(dahEdge)(uint32_t timestampUs, bool down)
+{
+    (void)timestampUs;
+    dahDown = down;
+    if (down) {
+        if (sending == ELEMENT_DIT) {
+            dahMemory = true;
+        }
+        schedulerStart();
+    }
+}
+
+static void configurePaddle(uint32_t pin)
+{
+    /* Paddle input:
+       1. SIO function, output disabled
+       2. Pull-up and input enable, the paddle shorts the pin to ground */
+    io->gpio[pin].ctrl = GPIO_FUNC_SIO;
+    sio->gpio_oe_clr = 1U << pin;
+    pads->gpio[pin] = PADS_GPIO_PUE | PADS_GPIO_IE;
+}
+
+void iambicInit(uint32_t ditPin, uint32_t dahPin, uint32_t lockoutUs,
+                enum iambicMode mode)
+{
+    keyerMode = mode;
+    sending = ELEMENT_NONE;
+    spacePending = false;
+    ditMemory = false;
+    dahMemory = false;
+
+    configurePaddle(ditPin);
+    configurePaddle(dahPin);
+
+    schedulerSetSource(iambicSource);
+    debounceAdd(ditPin, lockoutUs, true, ditEdge);
+    debounceAdd(dahPin, lockoutUs, true, dahEdge);
+}
+
+void iambicSetMode(enum iambicMode mode)
+{
+    keyerMode = mode;
+}
@@ -0,0 +1,43 @@
+/* Iambic Paddle Keyer
+ * Dit and dah paddles on two pins, debounced by debounce.h. The keyer is
+ * a scheduler source (scheduler.h): the TIMER alarm 0 interrupt asks for
+ * the next element at every element boundary, so each element and space
+ * lands on an absolute deadline and timing is exact to one TIMER tick.
+ * Paddle edges only update state and restart an idle scheduler.
+ *
+ * Squeezing both paddles alternates dits and dahs. Pressing the opposite
+ * paddle while an element is sent is remembered and sent next (squeeze
+ * memory). The modes differ when a squeeze is released:
+ * Mode A: keying stops after the element being sent
+ * Mode B: one more opposite element follows, because a paddle held at
+ *         any time during an element counts as a press */
+
+#ifndef IAMBIC_H
+#define IAMBIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum iambicMode {
+    IAMBIC_MODE_A,
+    IAMBIC_MODE_B
+};
+
+/* Configure both paddle pins as inputs with pull-ups (paddles close to
+ * ground), register them with the debouncer and install the keyer as the
+ * scheduler source. Call after schedulerInit() and debounceInit() */
+void iambicInit(uint32_t ditPin, uint32_t dahPin, uint32_t lockoutUs,
+                enum iambicMode mode);
+
+/* Switch between Mode A and Mode B, takes effect at the next element */
+void iambicSetMode(enum iambicMode mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IAMBIC_H */
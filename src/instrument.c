@@ -0,0 +1,112 @@
+/* Latency Instrumentation
+ * SysTick runs free from SYST_MAX on each recording core with its
+ * interrupt off, so timestamps cost one bus read and nothing ticks in the
+ * background. A core only reads its own SysTick.
+ *
+ * Both cores record into the one instrumentStats block, but never into
+ * the same words: each histogram is fed by one interrupt, which runs on
+ * one core (the alarm on core1 in KEYER_CORE1 builds, everything else on
+ * core0), and each core has its own recent[] ring. Only core0 clears the
+ * block, before it launches core1 */
+
+#include "rp2040.h"
+#include "instrument.h"
+
+#if defined(INSTRUMENT)
+
+/* Bin width: 16 cycles covers 1024 cycles (8 us at 125 MHz) in the
+   cycle histograms, lateness is binned per microsecond. An audio block
+   is a loop over its samples and gets 64-cycle bins, up to 4096 */
+#define INSTR_CYCLE_SHIFT 4
+#define INSTR_US_SHIFT 0
+#define INSTR_BLOCK_SHIFT 6
+
+typedef char instrRecentPowerOfTwo[(INSTR_RECENT & (INSTR_RECENT - 1)) == 0 ? 1 : -1];
+
+struct instrStats instrumentStats;
+volatile uint32_t instrEdgeStamp[2];
+volatile bool instrEdgeSeen[2];
+
+void instrInit(void)
+{
+    SYST_CSR = 0;
+    SYST_RVR = SYST_MAX;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_ENABLE;
+
+    /* Core1 starts after core0 has cleared the block and keeps it */
+    if (sio->cpuid != 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < INSTR_COUNT; i++) {
+        struct instrHistogram *h = &instrumentStats.hist[i];
+        h->count = 0;
+        h->min = 0xffffffffU;
+        h->max = 0;
+        h->shift = (i == INSTR_ALARM_LATE) ? INSTR_US_SHIFT :
+                   (i == INSTR_AUDIO_BLOCK) ? INSTR_BLOCK_SHIFT : INSTR_CYCLE_SHIFT;
+        for (uint32_t b = 0; b < INSTR_BINS; b++) {
+            h->bins[b] = 0;
+        }
+    }
+    for (uint32_t core = 0; core < 2; core++) {
+        instrumentStats.recentNext[core] = 0;
+        for (uint32_t n = 0; n < INSTR_RECENT; n++) {
+            instrumentStats.recent[core][n].id = INSTR_COUNT;
+            instrumentStats.recent[core][n].value = 0;
+        }
+    }
+    instrumentStats.histograms = INSTR_COUNT;
+    instrumentStats.bins = INSTR_BINS;
+    instrumentStats.magic = INSTR_MAGIC;
+}
+
+void __not_in_flash_func(instrRecord)(enum instrId id, uint32_t value)
+{
+    struct instrHistogram *h = &instrumentStats.hist[id];
+    uint32_t bin = value >> h->shift;
+    uint32_t core = sio->cpuid;
+    uint32_t next = instrumentStats.recentNext[core];
+
+    instrumentStats.recent[core][next].id = id;
+    instrumentStats.recent[core][next].value = value;
+    instrumentStats.recentNext[core] = (next + 1) & (INSTR_RECENT - 1);
+
+    if (bin >= INSTR_BINS) {
+        bin = INSTR_BINS - 1;
+    }
+    h->bins[bin]++;
+    h->count++;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+uint32_t instrPercentile(enum instrId id, uint32_t percent)
+{
+    const struct instrHistogram *h = &instrumentStats.hist[id];
+    uint32_t count = h->count;
+    uint32_t seen = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    /* count * percent / 100 split in two so it cannot overflow */
+    uint32_t hundreds = hwDivide(count, 100);
+    uint32_t target = hundreds * percent +
+                      hwDivide((count - hundreds * 100) * percent, 100);
+
+    for (uint32_t b = 0; b < INSTR_BINS - 1; b++) {
+        seen += h->bins[b];
+        if (seen > target) {
+            return ((b + 1) << h->shift) - 1;
+        }
+    }
+    return h->max;
+}
+
+#endif
@@ -0,0 +1,159 @@
+/* Latency Instrumentation
+ * Opt-in build (INSTRUMENT=1 in the Makefile) that measures how quickly
+ * the keying interrupts turn an event into an edge on the key pins:
+ * 1. instrEnter() stamps the interrupt entry with SysTick, which counts
+ *    core clock cycles
+ * 2. instrEdge() stamps the first SIO write to a key pin
+ * 3. instrExit() records entry to edge (if one happened) and entry to
+ *    exit into two histograms
+ * The scheduler also records how late each alarm edge lands against its
+ * deadline in TIMER microseconds.
+ *
+ * Results live in instrumentStats, a fixed RAM block that a debugger can
+ * read over SWD at any time without stopping the keyer, e.g.
+ *   (gdb) print instrumentStats
+ * Next to the histograms it keeps the last INSTR_RECENT samples of each
+ * core, which fault.h saves when the core faults.
+ * Nothing is printed and nothing is allocated. Without INSTRUMENT every
+ * call below compiles to nothing */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Histograms in instrumentStats */
+enum instrId {
+    INSTR_BUTTON_EDGE,  /* ioIrqBank0 entry to key edge, cycles */
+    INSTR_BUTTON_ISR,   /* ioIrqBank0 entry to exit, cycles */
+    INSTR_ALARM_EDGE,   /* timerIrq0 entry to key edge, cycles */
+    INSTR_ALARM_ISR,    /* timerIrq0 entry to exit, cycles */
+    INSTR_ALARM_LATE,   /* Alarm edge after its deadline, us */
+    INSTR_AUDIO_BLOCK,  /* dmaIrq1 entry to exit for one audio block, cycles */
+    INSTR_COUNT
+};
+
+/* Bins per histogram, the last one also collects everything above */
+#define INSTR_BINS 64
+
+/* "INST", lets a probe find the block without the ELF */
+#define INSTR_MAGIC 0x54534e49
+
+/* One histogram
+ * Bin i counts samples from i << shift up to ((i + 1) << shift) - 1 */
+struct instrHistogram {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t shift;
+    uint32_t bins[INSTR_BINS];
+};
+
+/* Last samples recorded per core, a power of two. An id of INSTR_COUNT
+ * marks a slot nothing was recorded into yet */
+#define INSTR_RECENT 8
+
+struct instrSample {
+    uint32_t id;
+    uint32_t value;
+};
+
+struct instrStats {
+    uint32_t magic;
+    uint32_t histograms;    /* INSTR_COUNT */
+    uint32_t bins;          /* INSTR_BINS */
+    struct instrHistogram hist[INSTR_COUNT];
+    uint32_t recentNext[2]; /* Slot the core records into next, its oldest */
+    struct instrSample recent[2][INSTR_RECENT];
+};
+
+#if defined(INSTRUMENT)
+
+extern struct instrStats instrumentStats;
+
+/* Key edge stamps, one per core */
+extern volatile uint32_t instrEdgeStamp[2];
+extern volatile bool instrEdgeSeen[2];
+
+/* Start SysTick free-running on the calling core, core0 also resets the
+ * results. Call on each core that records, on core0 before core1 starts */
+void instrInit(void);
+
+/* Add one sample to histogram id */
+void instrRecord(enum instrId id, uint32_t value);
+
+/* Upper bound of the bin holding the given percentile of histogram id,
+ * e.g. 99 for p99. Returns 0 while it is empty. Not for interrupts */
+uint32_t instrPercentile(enum instrId id, uint32_t percent);
+
+/* SysTick counts down, so elapsed cycles are start - now modulo 2^24,
+ * good for intervals up to 134 ms at 125 MHz */
+static inline uint32_t instrElapsed(uint32_t start)
+{
+    return (start - SYST_CVR) & SYST_MAX;
+}
+
+static inline uint32_t instrEnter(void)
+{
+    instrEdgeSeen[sio->cpuid] = false;
+    return SYST_CVR;
+}
+
+/* Call right after the SIO write that moves the key */
+static inline void instrEdge(void)
+{
+    uint32_t core = sio->cpuid;
+    if (!instrEdgeSeen[core]) {
+        instrEdgeStamp[core] = SYST_CVR;
+        instrEdgeSeen[core] = true;
+    }
+}
+
+static inline void instrExit(enum instrId edgeId, enum instrId isrId, uint32_t start)
+{
+    uint32_t core = sio->cpuid;
+    if (instrEdgeSeen[core]) {
+        instrRecord(edgeId, (start - instrEdgeStamp[core]) & SYST_MAX);
+    }
+    instrRecord(isrId, instrElapsed(start));
+}
+
+/* Record how late an edge due at deadlineUs happened */
+static inline void instrLate(uint32_t deadlineUs)
+{
+    instrRecord(INSTR_ALARM_LATE, timer->timerawl - deadlineUs);
+}
+
+#else
+
+static inline void instrInit(void) {}
+static inline uint32_t instrEnter(void) { return 0; }
+static inline void instrEdge(void) {}
+static inline void instrExit(enum instrId edgeId, enum instrId isrId, uint32_t start)
+{
+    (void)edgeId;
+    (void)isrId;
+    (void)start;
+}
+static inline void instrLate(uint32_t deadlineUs) { (void)deadlineUs; }
+static inline uint32_t instrElapsed(uint32_t start) { (void)start; return 0; }
+static inline void instrRecord(enum instrId id, uint32_t value)
+{
+    (void)id;
+    (void)value;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INSTRUMENT_H */
@@ -0,0 +1,224 @@
+/* Morse Encoder
+ * Every character costs one load from morseTable. Each element becomes
+ * a key down symbol whose length is computed from its bit (1 + 2 * bit
+ * units), so there is no per-element lookup or branch on dit vs dah */
+
+#include "rp2040.h"
+#include "scheduler.h"
+#include "morse.h"
+
+/* International Morse code, one entry per 7-bit ASCII character
+ * Lower case letters share the upper case codes so no case folding is
+ * needed at encode time. Other bytes have no code, see morseCode() */
+const uint16_t morseTable[128] = {
+    /* 00 01 02 03 04 05 06 07 */
+    MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE,
+    /* 08 09 0a 0b 0c 0d 0e 0f */
+    MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE,
+    /* 10 11 12 13 14 15 16 17 */
+    MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE,
+    /* 18 19 1a 1b 1c 1d 1e 1f */
+    MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE,
+    /* sp ! " # $ % & ' */
+    MORSE_NONE, MORSE(6, 0x35), MORSE(6, 0x12), MORSE_NONE, MORSE(7, 0x48), MORSE_NONE, MORSE(5, 0x02), MORSE(6, 0x1e),
+    /* ( ) * + , - . / */
+    MORSE(5, 0x0d), MORSE(6, 0x2d), MORSE_NONE, MORSE(5, 0x0a), MORSE(6, 0x33), MORSE(6, 0x21), MORSE(6, 0x2a), MORSE(5, 0x09),
+    /* 0 1 2 3 4 5 6 7 */
+    MORSE(5, 0x1f), MORSE(5, 0x1e), MORSE(5, 0x1c), MORSE(5, 0x18), MORSE(5, 0x10), MORSE(5, 0x00), MORSE(5, 0x01), MORSE(5, 0x03),
+    /* 8 9 : ; < = > ? */
+    MORSE(5, 0x07), MORSE(5, 0x0f), MORSE(6, 0x07), MORSE(6, 0x15), MORSE_NONE, MORSE(5, 0x11), MORSE_NONE, MORSE(6, 0x0c),
+    /* @ A B C D E F G */
+    MORSE(6, 0x16), MORSE(2, 0x02), MORSE(4, 0x01), MORSE(4, 0x05), MORSE(3, 0x01), MORSE(1, 0x00), MORSE(4, 0x04), MORSE(3, 0x03),
+    /* H I J K L M N O */
+    MORSE(4, 0x00), MORSE(2, 0x00), MORSE(4, 0x0e), MORSE(3, 0x05), MORSE(4, 0x02), MORSE(2, 0x03), MORSE(2, 0x01), MORSE(3, 0x07),
+    /* P Q R S T U V W */
+    MORSE(4, 0x06), MORSE(4, 0x0b), MORSE(3, 0x02), MORSE(3, 0x00), MORSE(1, 0x01), MORSE(3, 0x04), MORSE(4, 0x08), MORSE(3, 0x06),
+    /* X Y Z [ \ ] ^ _ */
+    MORSE(4, 0x09), MORSE(4, 0x0d), MORSE(4, 0x03), MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE(6, 0x2c),
+    /* ` a b c d e f g */
+    MORSE_NONE, MORSE(2, 0x02), MORSE(4, 0x01), MORSE(4, 0x05), MORSE(3, 0x01), MORSE(1, 0x00), MORSE(4, 0x04), MORSE(3, 0x03),
+    /* h i j k l m n o */
+    MORSE(4, 0x00), MORSE(2, 0x00), MORSE(4, 0x0e), MORSE(3, 0x05), MORSE(4, 0x02), MORSE(2, 0x03), MORSE(2, 0x01), MORSE(3, 0x07),
+    /* p q r s t u v w */
+    MORSE(4, 0x06), MORSE(4, 0x0b), MORSE(3, 0x02), MORSE(3, 0x00), MORSE(1, 0x01), MORSE(3, 0x04), MORSE(4, 0x08), MORSE(3, 0x06),
+    /* x y z { | } ~ 7f */
+    MORSE(4, 0x09), MORSE(4, 0x0d), MORSE(4, 0x03), MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE, MORSE_NONE
+};
+
+/* Code of character c, MORSE_NONE for bytes above 7-bit ASCII, which
+ * are skipped rather than folded onto it (Latin-1, UTF-8 lead bytes) */
+static inline uint16_t morseCode(char c)
+{
+    uint32_t byte = (uint8_t)c;
+    return byte < 128 ? morseTable[byte] : MORSE_NONE;
+}
+
+/* Streaming encoder state, advanced from the scheduler's alarm interrupt */
+static const char *volatile streamText;  /* Next character to encode */
+static uint32_t streamElements;          /* Remaining elements of the current character */
+static uint32_t streamCount;             /* Number of remaining elements */
+static uint8_t pendingGap;               /* Key up symbol owed after the last key down */
+
+/* Gap that follows the last element of a character
+ * Skips any spaces after it, which turn the letter gap into a word gap */
+static uint8_t __not_in_flash_func(letterGap)(const char **text)
+{
+    const char *next = *text;
+    uint8_t gap = SYMBOL_UP(MORSE_LETTER_GAP);
+
+    while (*next == ' ') {
+        gap = SYMBOL_UP(MORSE_WORD_GAP);
+        next++;
+    }
+    *text = next;
+    return gap;
+}
+
+uint32_t morseDitUs(uint32_t wpm)
+{
+    /* PARIS is 50 units long, so one dit is 60 s / (50 * wpm) */
+    return hwDivide(1200000U, wpm);
+}
+
+uint32_t morseEncode(const char *text, uint8_t *out, uint32_t maxSymbols)
+{
+    uint32_t written = 0;
+
+    while (*text != 0) {
+        uint16_t entry = morseCode(*text);
+        uint32_t count = MORSE_COUNT(entry);
+        uint32_t elements = MORSE_ELEMENTS(entry);
+
+        /* Every element is a key down plus the gap after it */
+        if (written + 2 * count > maxSymbols) {
+            break;
+        }
+        text++;
+
+        while (count != 0) {
+            out[written++] = SYMBOL_DOWN(1 + ((elements & 1) << 1));
+            out[written++] = SYMBOL_UP(MORSE_ELEMENT_GAP);
+            elements >>= 1;
+            count--;
+        }
+
+        if (MORSE_COUNT(entry) != 0) {
+            out[written - 1] = letterGap(&text);
+        }
+    }
+
+    return written;
+}
+
+/* Symbol source, called from the keying engine's interrupt */
+uint8_t __not_in_flash_func(morseNextSymbol)(void)
+{
+    uint8_t symbol = pendingGap;
+
+    if (symbol != 0) {
+        pendingGap = 0;
+        return symbol;
+    }
+
+    /* Load the next character with a code, skipping unsupported ones */
+    while (streamCount == 0) {
+        const char *text = streamText;
+        if (text == 0 || *text == 0) {
+            streamText = 0;
+            return 0;
+        }
+        uint16_t entry = morseCode(*text);
+        streamText = text + 1;
+        streamCount = MORSE_COUNT(entry);
+        streamElements = MORSE_ELEMENTS(entry);
+    }
+
+    symbol = SYMBOL_DOWN(1 + ((streamElements & 1) << 1));
+    streamElements >>= 1;
+
+    if (--streamCount != 0) {
+        pendingGap = SYMBOL_UP(MORSE_ELEMENT_GAP);
+    } else {
+        const char *text = streamText;
+        pendingGap = letterGap(&text);
+        streamText = text;
+    }
+
+    return symbol;
+}
+
+void morseStream(const char *text)
+{
+    uint32_t primask = irqDisable();
+    streamText = text;
+    streamCount = 0;
+    pendingGap = 0;
+    irqRestore(primask);
+}
+
+void morseSend(const char *text)
+{
+    morseStream(text);
+    schedulerSetSource(morseNextSymbol);
+    schedulerStart();
+}
+
+/* Character source encoder state, advanced from the scheduler's alarm
+ * interrupt. Characters arrive one at a time, so a letter always ends
+ * with a letter gap and the first space after it adds the rest of the
+ * word gap */
+static morseCharSource charSource;
+static uint32_t sourceElements;
+static uint32_t sourceCount;
+static uint8_t sourcePendingGap;
+static bool sourceSpaced;       /* Word gap already sent for this run of spaces */
+
+uint8_t __not_in_flash_func(morseNextSourceSymbol)(void)
+{
+    uint8_t symbol = sourcePendingGap;
+    char c;
+
+    if (symbol != 0) {
+        sourcePendingGap = 0;
+        return symbol;
+    }
+
+    /* Load the next character with a code, line ends count as spaces */
+    while (sourceCount == 0) {
+        if (charSource == 0 || !charSource(&c)) {
+            return 0;
+        }
+        if (c == ' ' || c == '\r' || c == '\n') {
+            if (!sourceSpaced) {
+                sourceSpaced = true;
+                return SYMBOL_UP(MORSE_WORD_GAP - MORSE_LETTER_GAP);
+            }
+            continue;
+        }
+        uint16_t entry = morseCode(c);
+        sourceCount = MORSE_COUNT(entry);
+        sourceElements = MORSE_ELEMENTS(entry);
+    }
+
+    symbol = SYMBOL_DOWN(1 + ((sourceElements & 1) << 1));
+    sourceElements >>= 1;
+    sourceSpaced = false;
+    sourcePendingGap = SYMBOL_UP(--sourceCount != 0 ? MORSE_ELEMENT_GAP : MORSE_LETTER_GAP);
+
+    return symbol;
+}
+
+void morseStreamSource(morseCharSource source)
+{
+    uint32_t primask = irqDisable();
+    charSource = source;
+    sourceCount = 0;
+    sourcePendingGap = 0;
+    sourceSpaced = true;
+    irqRestore(primask);
+}
+
+bool morseBusy(void)
+{
+    return streamText != 0 || streamCount != 0 || pendingGap != 0;
+}
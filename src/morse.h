@@ -0,0 +1,74 @@
+/* Morse Encoder
+ * Turns ASCII text into scheduler symbols (see scheduler.h) using standard
+ * PARIS timing: dit 1 unit, dah 3 units, 1 unit between elements,
+ * 3 units between letters and 7 units between words */
+
+#ifndef MORSE_H
+#define MORSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Table entry format
+ * Bits 0-7: elements, first element in bit 0, 1 = dah and 0 = dit
+ * Bits 8-10: number of elements (0 for characters without a code) */
+#define MORSE(count, elements)  ((uint16_t)(((count) << 8) | (elements)))
+#define MORSE_NONE              ((uint16_t)0)
+#define MORSE_COUNT(entry)      ((uint32_t)(entry) >> 8)
+#define MORSE_ELEMENTS(entry)   ((uint32_t)(entry) & 0xff)
+
+/* Gap lengths in dit units */
+#define MORSE_ELEMENT_GAP   1
+#define MORSE_LETTER_GAP    3
+#define MORSE_WORD_GAP      7
+
+/* Character to code table, indexed by 7-bit ASCII, lives in .rodata */
+extern const uint16_t morseTable[128];
+
+/* Dit length in microseconds for a speed in words per minute */
+uint32_t morseDitUs(uint32_t wpm);
+
+/* Encode text into symbols
+ * Writes at most maxSymbols symbols to out and returns how many were
+ * written, stopping early at a character boundary when out is full */
+uint32_t morseEncode(const char *text, uint8_t *out, uint32_t maxSymbols);
+
+/* Start streaming text one symbol at a time through morseNextSymbol()
+ * text must stay valid until morseBusy() returns false */
+void morseStream(const char *text);
+
+/* Next symbol of the streamed text, 0 once it is exhausted
+ * Matches schedulerSource so any keying engine can pull from it */
+uint8_t morseNextSymbol(void);
+
+/* Stream text through the scheduler
+ * Attaches the encoder as the scheduler's symbol source so symbols are
+ * generated one at a time from the alarm interrupt */
+void morseSend(const char *text);
+
+/* Character source for open-ended input such as a serial port
+ * Stores the next character in c and returns true, or returns false when
+ * none is waiting. Called from the keying engine's interrupt */
+typedef bool (*morseCharSource)(char *c);
+
+/* Encode characters pulled one at a time from source
+ * Attach morseNextSourceSymbol() as the symbol source and restart the
+ * keying engine whenever source has new characters */
+void morseStreamSource(morseCharSource source);
+
+/* Next symbol from the character source, 0 while it has nothing waiting
+ * Matches schedulerSource */
+uint8_t morseNextSourceSymbol(void);
+
+/* True while a streamed message is still being encoded */
+bool morseBusy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MORSE_H */
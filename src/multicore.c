@@ -0,0 +1,209 @@
+/* Dual-Core Support
+ * FIFO traffic
+ * core0 -> core1: KEYER_CMD_KICK after pushing symbols, or a pointer to
+ *                 text to stream through the encoder
+ * core1 -> core0: KEYER_EVENT_TEXT_DONE when streamed text runs out
+ * Core1 only writes from its interrupts and never waits for room: a done
+ * event that finds the FIFO full stays latched and goes out on core1's
+ * next scheduler event or command. Core0 kicks core1 after draining a
+ * full FIFO, so the retry comes even if nothing else is queued
+ * The shared ring is single-consumer (core1) and its producers are
+ * serialised by KEYER_SPINLOCK, so any context on either core may push */
+
+#include "rp2040.h"
+#include "ring.h"
+#include "scheduler.h"
+#include "morse.h"
+#include "multicore.h"
+#include "instrument.h"
+
+/* FIFO message values, text pointers are always non-zero */
+#define KEYER_CMD_KICK          0
+#define KEYER_EVENT_TEXT_DONE   1
+
+/* Core1 stack, 1 KB is plenty for the scheduler's interrupt handlers */
+#define CORE1_STACK_WORDS 256
+static uint32_t core1Stack[CORE1_STACK_WORDS];
+
+/* Symbols handed from core0 to the keyer core */
+RING_DEFINE(keyerRing, KEYER_RING_SIZE);
+
+static uint32_t keyerMask;          /* Passed to schedulerInit() on core1 */
+static uint32_t keyerDitUs;
+static volatile bool textBusy;      /* core0: text sent, not yet done */
+static bool textActive;             /* core1: encoder is the current source */
+static bool textDonePending;        /* core1: done event waits for FIFO room */
+
+static inline void fifoPushBlocking(uint32_t value)
+{
+    while ((sio->fifo_st & SIO_FIFO_ST_RDY) == 0) {}
+    sio->fifo_wr = value;
+    __asm volatile("sev");
+}
+
+static inline uint32_t fifoPopBlocking(void)
+{
+    while ((sio->fifo_st & SIO_FIFO_ST_VLD) == 0) {
+        __asm volatile("wfe");
+    }
+    return sio->fifo_rd;
+}
+
+static inline void fifoDrain(void)
+{
+    while (sio->fifo_st & SIO_FIFO_ST_VLD) {
+        (void)sio->fifo_rd;
+    }
+}
+
+void multicoreLaunch(void (*entry)(void), uint32_t *stackTop)
+{
+    /* Bootrom handshake: each word must be echoed back by core1, any
+       mismatch restarts the sequence. Zeros resynchronise core1 */
+    const uint32_t sequence[] = {
+        0, 0, 1, M0PLUS_VTOR, (uint32_t)stackTop, (uint32_t)entry
+    };
+    uint32_t step = 0;
+
+    do {
+        uint32_t word = sequence[step];
+        if (word == 0) {
+            fifoDrain();
+            __asm volatile("sev");
+        }
+        fifoPushBlocking(word);
+        uint32_t response = fifoPopBlocking();
+        step = (response == word) ? step + 1 : 0;
+    } while (step < sizeof(sequence) / sizeof(sequence[0]));
+}
+
+/* Send a latched done event to core0 if the FIFO has room
+ * Core1 only, from its alarm and SIO handlers, which share one priority
+ * and so never interrupt each other here */
+static inline void __not_in_flash_func(textDoneFlush)(void)
+{
+    if (textDonePending && (sio->fifo_st & SIO_FIFO_ST_RDY)) {
+        sio->fifo_wr = KEYER_EVENT_TEXT_DONE;
+        __asm volatile("sev");
+        textDonePending = false;
+    }
+}
+
+/* Scheduler source on core1
+ * Symbols pushed by core0 first, then streamed text */
+static uint8_t __not_in_flash_func(keyerCoreSource)(void)
+{
+    uint32_t symbol;
+
+    textDoneFlush();
+    if (ringPop(&keyerRing, &symbol)) {
+        return (uint8_t)symbol;
+    }
+
+    if (textActive) {
+        symbol = morseNextSymbol();
+        if (symbol != 0) {
+            return (uint8_t)symbol;
+        }
+        textActive = false;
+        textDonePending = true;
+        textDoneFlush();
+    }
+    return 0;
+}
+
+/* Core1 entry point
+ * Runs from SRAM so the idle loop never fetches through the XIP cache
+ * that core0 is using */
+static void __not_in_flash_func(keyerCoreMain)(void)
+{
+    instrInit();
+    schedulerInit(keyerMask, keyerDitUs);
+    schedulerSetSource(keyerCoreSource);
+
+    fifoDrain();
+    sio->fifo_st = SIO_FIFO_ST_WOF | SIO_FIFO_ST_ROE;
+    NVIC_ISER = 1U << SIO_IRQ_PROC1;
+
+    while (true) {
+        __asm volatile("wfi");
+    }
+}
+
+/* Interrupt handler for SIO on core1
+ * Overrides the weak alias in startup.c. Takes commands from core0 and
+ * restarts the scheduler, which pulls from keyerCoreSource() */
+void __not_in_flash_func(sioIrqProc1)(void)
+{
+    while (sio->fifo_st & SIO_FIFO_ST_VLD) {
+        uint32_t cmd = sio->fifo_rd;
+        if (cmd != KEYER_CMD_KICK) {
+            morseStream((const char *)cmd);
+            textActive = true;
+        }
+    }
+    sio->fifo_st = SIO_FIFO_ST_WOF | SIO_FIFO_ST_ROE;
+
+    textDoneFlush();
+    schedulerStart();
+}
+
+/* Interrupt handler for SIO on core0
+ * Overrides the weak alias in startup.c. Collects events from core1, and
+ * kicks it after a full FIFO so an event it latched goes out */
+void __not_in_flash_func(sioIrqProc0)(void)
+{
+    uint32_t count = 0;
+
+    while (sio->fifo_st & SIO_FIFO_ST_VLD) {
+        if (sio->fifo_rd == KEYER_EVENT_TEXT_DONE) {
+            textBusy = false;
+        }
+        count++;
+    }
+    sio->fifo_st = SIO_FIFO_ST_WOF | SIO_FIFO_ST_ROE;
+
+    /* A full FIFO towards core1 already rings it */
+    if (count >= SIO_FIFO_DEPTH && (sio->fifo_st & SIO_FIFO_ST_RDY)) {
+        sio->fifo_wr = KEYER_CMD_KICK;
+    }
+}
+
+void keyerCoreStart(uint32_t keyMask, uint32_t ditUs)
+{
+    keyerMask = keyMask;
+    keyerDitUs = ditUs;
+
+    multicoreLaunch(keyerCoreMain, &core1Stack[CORE1_STACK_WORDS]);
+
+    /* Only listen for core1 events once the handshake is over */
+    fifoDrain();
+    sio->fifo_st = SIO_FIFO_ST_WOF | SIO_FIFO_ST_ROE;
+    NVIC_ISER = 1U << SIO_IRQ_PROC0;
+}
+
+bool __not_in_flash_func(keyerCorePush)(uint8_t symbol)
+{
+    uint32_t primask = irqDisable();
+    spinLock(KEYER_SPINLOCK);
+    bool queued = ringPush(&keyerRing, symbol);
+    spinUnlock(KEYER_SPINLOCK);
+    irqRestore(primask);
+
+    /* A full FIFO already holds a message that will wake core1 */
+    if (queued && (sio->fifo_st & SIO_FIFO_ST_RDY)) {
+        sio->fifo_wr = KEYER_CMD_KICK;
+    }
+    return queued;
+}
+
+void keyerCoreSend(const char *text)
+{
+    textBusy = true;
+    fifoPushBlocking((uint32_t)text);
+}
+
+bool keyerCoreBusy(void)
+{
+    return textBusy;
+}
@@ -0,0 +1,65 @@
+/* Dual-Core Support
+ * Launches core1 through the bootrom FIFO handshake and provides the
+ * keyer core: core1 owns the TIMER scheduler and its alarm interrupt,
+ * while core0 services input. Core0 hands symbols over through a shared
+ * ring guarded by a hardware spinlock and rings core1 through the SIO
+ * FIFO, so keying timing on core1 never sees core0's interrupt load */
+
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Hardware spinlock guarding the shared keyer ring */
+#define KEYER_SPINLOCK 0
+
+/* Symbols the shared ring can hold, must be a power of two */
+#define KEYER_RING_SIZE 64
+
+/* Claim a hardware spinlock, spinning until it is free
+ * Mask interrupts first if an interrupt handler on the same core can
+ * take the same lock */
+static inline void spinLock(uint32_t lock)
+{
+    while (sio->spinlock[lock] == 0) {}
+    __asm volatile("dmb" ::: "memory");
+}
+
+static inline void spinUnlock(uint32_t lock)
+{
+    __asm volatile("dmb" ::: "memory");
+    sio->spinlock[lock] = 0;
+}
+
+/* Start core1 at entry with its stack pointer at stackTop
+ * Core1 uses the same vector table as core0 */
+void multicoreLaunch(void (*entry)(void), uint32_t *stackTop);
+
+/* Launch core1 as the keyer core running the TIMER scheduler
+ * keyMask and ditUs as for schedulerInit(). Call from core0 after
+ * clocksInit() */
+void keyerCoreStart(uint32_t keyMask, uint32_t ditUs);
+
+/* Queue one symbol for core1, callable from any core0 context
+ * Returns false if the shared ring is full */
+bool keyerCorePush(uint8_t symbol);
+
+/* Stream text on core1 through the Morse encoder
+ * text must stay valid until keyerCoreBusy() returns false */
+void keyerCoreSend(const char *text);
+
+/* True while text sent with keyerCoreSend() is still being encoded */
+bool keyerCoreBusy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTICORE_H */
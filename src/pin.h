@@ -0,0 +1,95 @@
+/* Compile-Time GPIO Pins
+ * Header-only C++ layer over the SIO, IO Bank 0 and pad registers. The
+ * pin number is a template parameter, so every mask and register index
+ * is a constant and each operation is a single store of a literal:
+ *   Pin<LED_PIN>::set();                       one str to gpio_out_set
+ *   PinGroup<LED_PIN, SPEAKER_PIN>::clear();   one str, both pins
+ * Nothing here has state or a constructor, so it adds no .data, .bss or
+ * init_array entries. C modules keep using the registers directly */
+
+#ifndef PIN_H
+#define PIN_H
+
+#ifndef __cplusplus
+#error "pin.h is C++ only"
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+
+/* Bits of the pins in Ns, folded at compile time */
+template <uint32_t... Ns>
+constexpr uint32_t pinMask()
+{
+    return (0U | ... | (1U << Ns));
+}
+
+/* One GPIO */
+template <uint32_t N>
+struct Pin {
+    static_assert(N < 30, "RP2040 has GPIO 0-29");
+
+    static constexpr uint32_t mask = 1U << N;
+    static constexpr uint32_t bank = N / 8;         /* intr and inte word */
+    static constexpr uint32_t shift = 4 * (N % 8);  /* Event bits in that word */
+
+    static void set() { sio->gpio_out_set = mask; }
+    static void clear() { sio->gpio_out_clr = mask; }
+    static void toggle() { sio->gpio_out_xor = mask; }
+    static void write(bool high)
+    {
+        if (high) {
+            set();
+        } else {
+            clear();
+        }
+    }
+    static bool read() { return (sio->gpio_in & mask) != 0; }
+
+    static void output() { sio->gpio_oe_set = mask; }
+    static void input() { sio->gpio_oe_clr = mask; }
+
+    /* GPIO_FUNC_ value for the pin's peripheral */
+    static void function(uint32_t func) { io->gpio[N].ctrl = func; }
+
+    /* PADS_GPIO_ bits */
+    static void pad(uint32_t flags) { pads->gpio[N] = flags; }
+
+    /* GPIO_INT_ events, for core0 */
+    static void enableIrq(uint32_t events) { io->proc0_inte[bank] |= events << shift; }
+    static void disableIrq(uint32_t events) { io->proc0_inte[bank] &= ~(events << shift); }
+    static void clearIrq(uint32_t events) { io->intr[bank] = events << shift; }
+    static uint32_t irqStatus() { return (io->proc0_ints[bank] >> shift) & 0xfU; }
+};
+
+/* Pins switched together with one store to the SIO set, clear or enable
+ * registers. Configuration still goes through every pin */
+template <uint32_t... Ns>
+struct PinGroup {
+    static_assert(sizeof...(Ns) != 0, "empty pin group");
+    static_assert(((Ns < 30) && ...), "RP2040 has GPIO 0-29");
+
+    static constexpr uint32_t mask = pinMask<Ns...>();
+
+    static void set() { sio->gpio_out_set = mask; }
+    static void clear() { sio->gpio_out_clr = mask; }
+    static void toggle() { sio->gpio_out_xor = mask; }
+    static void write(bool high)
+    {
+        if (high) {
+            set();
+        } else {
+            clear();
+        }
+    }
+
+    static void output() { sio->gpio_oe_set = mask; }
+    static void input() { sio->gpio_oe_clr = mask; }
+
+    static void function(uint32_t func) { ((io->gpio[Ns].ctrl = func), ...); }
+    static void pad(uint32_t flags) { ((pads->gpio[Ns] = flags), ...); }
+};
+
+#endif /* PIN_H */
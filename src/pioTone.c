@@ -0,0 +1,178 @@
+/* PIO Tone and Keying Generator
+ * The state machine program below is hand assembled. The first word
+ * pushed after start is the half-period loop count, which the program
+ * parks in ISR (the input shift register is otherwise unused). Every
+ * later word is a symbol: key flag in bit 0, tone periods minus one above
+ *
+ *  0:        pull block          ; half-period loop count
+ *  1:        mov isr, osr
+ *  2: top:   pull block          ; .wrap_target
+ *  3:        out x, 1            ; key flag
+ *  4:        out y, 31           ; periods - 1
+ *  5:        jmp !x, silent
+ *  6: tone:  set pins, 1
+ *  7:        mov x, isr
+ *  8: hi:    jmp x--, hi
+ *  9:        set pins, 0
+ * 10:        mov x, isr
+ * 11: lo:    jmp x--, lo
+ * 12:        jmp y--, tone       ; .wrap
+ * 13: silent: mov x, isr [2]     ; padded to match the tone loop
+ * 14: s1:    jmp x--, s1
+ * 15:        mov x, isr
+ * 16: s2:    jmp x--, s2
+ * 17:        jmp y--, silent
+ * 18:        jmp top
+ *
+ * Both loops take 2 * x + 7 cycles per period. A key down symbol then
+ * wraps back to top for free, while a key up symbol leaves through the
+ * jmp at 18, so it lasts one PIO cycle (one clk_sys cycle, as the
+ * divider is 1) longer than a key down symbol of the same length. Text
+ * runs late by one cycle per key up symbol, well under a microsecond for
+ * a whole message */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "pioTone.h"
+
+/* State machine used on PIO0 */
+#define PIO_TONE_SM 0
+
+/* Program and its wrap points */
+#define PROGRAM_WRAP_TARGET 2
+#define PROGRAM_WRAP        12
+#define PROGRAM_PERIOD_OVERHEAD 7   /* Fixed cycles per period, see above */
+
+static const uint16_t toneProgram[] = {
+    0x80a0, /*  0: pull block */
+    0xa0c7, /*  1: mov isr, osr */
+    0x80a0, /*  2: pull block */
+    0x6021, /*  3: out x, 1 */
+    0x605f, /*  4: out y, 31 */
+    0x002d, /*  5: jmp !x, 13 */
+    0xe001, /*  6: set pins, 1 */
+    0xa026, /*  7: mov x, isr */
+    0x0048, /*  8: jmp x--, 8 */
+    0xe000, /*  9: set pins, 0 */
+    0xa026, /* 10: mov x, isr */
+    0x004b, /* 11: jmp x--, 11 */
+    0x0086, /* 12: jmp y--, 6 */
+    0xa226, /* 13: mov x, isr [2] */
+    0x004e, /* 14: jmp x--, 14 */
+    0xa026, /* 15: mov x, isr */
+    0x0050, /* 16: jmp x--, 16 */
+    0x008d, /* 17: jmp y--, 13 */
+    0x0002, /* 18: jmp 2 */
+};
+
+/* Instructions executed through SMx_INSTR during setup */
+#define PIO_INSTR_SET_PINDIRS_1 0xe081
+#define PIO_INSTR_SET_PINS_0    0xe000
+#define PIO_INSTR_JMP(addr)     (0x0000 | (addr))
+
+/* Register fields */
+#define PIO_CTRL_SM_ENABLE(sm)      (1U << (sm))
+#define PIO_FSTAT_TXFULL(sm)        (1U << (16 + (sm)))
+#define PIO_FSTAT_TXEMPTY(sm)       (1U << (24 + (sm)))
+#define PIO_INT_TXNFULL(sm)         (1U << (4 + (sm)))
+#define PIO_EXECCTRL_WRAP(top, bottom) (((top) << 12) | ((bottom) << 7))
+#define PIO_SHIFTCTRL_OUT_RIGHT     (1U << 19)
+#define PIO_SHIFTCTRL_FJOIN_TX      (1U << 30)
+#define PIO_PINCTRL_SET(base, count) (((base) << 5) | ((count) << 26))
+#define PIO_CLKDIV_INT(n)           ((n) << 16)
+
+static uint32_t periodsPerUnit;         /* Tone periods in one dit unit */
+static uint32_t timingGeneration;       /* Bumped by every pioToneInit */
+static schedulerSource symbolSource;    /* Refills the FIFO from pio0Irq0 */
+
+void pioToneInit(uint32_t pin, uint32_t toneHz, uint32_t ditUs)
+{
+    volatile struct pio_sm_hw *sm = &pio0->sm[PIO_TONE_SM];
+    uint32_t sysHz = clockGetHz(CLK_SYS);
+
+    /* Period in PIO cycles rounded to what the loop can produce */
+    uint32_t halfLoop = (hwDivide(sysHz, toneHz) - PROGRAM_PERIOD_OVERHEAD) >> 1;
+    uint32_t period = 2 * halfLoop + PROGRAM_PERIOD_OVERHEAD;
+    uint32_t ditCycles = ditUs * hwDivide(sysHz, 1000000U);
+    periodsPerUnit = hwDivide(ditCycles + (period >> 1), period);
+    timingGeneration++;
+
+    /* Reset PIO0 and load the program at offset 0 */
+    RESETS_RESET |= RESET_PIO0;
+    RESETS_RESET &= ~RESET_PIO0;
+    while ((RESETS_RESET_DONE & RESET_PIO0) == 0) {}
+
+    for (uint32_t i = 0; i < sizeof(toneProgram) / sizeof(toneProgram[0]); i++) {
+        pio0->instr_mem[i] = toneProgram[i];
+    }
+
+    sm->clkdiv = PIO_CLKDIV_INT(1);
+    sm->execctrl = PIO_EXECCTRL_WRAP(PROGRAM_WRAP, PROGRAM_WRAP_TARGET);
+    sm->shiftctrl = PIO_SHIFTCTRL_OUT_RIGHT | PIO_SHIFTCTRL_FJOIN_TX;
+    sm->pinctrl = PIO_PINCTRL_SET(pin, 1);
+
+    /* Hand the pin to PIO0, drive it low as an output */
+    io->gpio[pin].ctrl = GPIO_FUNC_PIO0;
+    sm->instr = PIO_INSTR_SET_PINS_0;
+    sm->instr = PIO_INSTR_SET_PINDIRS_1;
+    sm->instr = PIO_INSTR_JMP(0);
+
+    /* First word is the half-period loop count, then run */
+    pio0->txf[PIO_TONE_SM] = halfLoop;
+    pio0->ctrl |= PIO_CTRL_SM_ENABLE(PIO_TONE_SM);
+
+    NVIC_ISER = 1U << PIO0_IRQ_0;
+}
+
+uint32_t __not_in_flash_func(pioToneWord)(uint8_t symbol)
+{
+    return PIO_TONE_WORD(symbol & SYMBOL_KEY_DOWN,
+                         (symbol & SYMBOL_UNITS_MASK) * periodsPerUnit);
+}
+
+uint32_t pioToneGeneration(void)
+{
+    return timingGeneration;
+}
+
+bool __not_in_flash_func(pioTonePush)(uint8_t symbol)
+{
+    if (pio0->fstat & PIO_FSTAT_TXFULL(PIO_TONE_SM)) {
+        return false;
+    }
+    pio0->txf[PIO_TONE_SM] = pioToneWord(symbol);
+    return true;
+}
+
+/* Interrupt handler for PIO0 IRQ 0
+ * Overrides the weak alias in startup.c. Fires while the TX FIFO has
+ * space and refills it from the source, disabling itself once the source
+ * runs dry so it costs nothing until the next pioToneStart() */
+void __not_in_flash_func(pio0Irq0)(void)
+{
+    while ((pio0->fstat & PIO_FSTAT_TXFULL(PIO_TONE_SM)) == 0) {
+        uint8_t symbol = symbolSource != 0 ? symbolSource() : 0;
+        if (symbol == 0) {
+            pio0->irq0_inte &= ~PIO_INT_TXNFULL(PIO_TONE_SM);
+            break;
+        }
+        pio0->txf[PIO_TONE_SM] = pioToneWord(symbol);
+    }
+}
+
+void pioToneSetSource(schedulerSource source)
+{
+    symbolSource = source;
+}
+
+void pioToneStart(void)
+{
+    pio0->irq0_inte |= PIO_INT_TXNFULL(PIO_TONE_SM);
+}
+
+bool pioToneIdle(void)
+{
+    return (pio0->irq0_inte & PIO_INT_TXNFULL(PIO_TONE_SM)) == 0 &&
+           (pio0->fstat & PIO_FSTAT_TXEMPTY(PIO_TONE_SM)) != 0 &&
+           pio0->sm[PIO_TONE_SM].addr == PROGRAM_WRAP_TARGET;
+}
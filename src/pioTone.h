@@ -0,0 +1,56 @@
+/* PIO Tone and Keying Generator
+ * A PIO0 state machine generates the sidetone square wave and gates it
+ * from a FIFO of symbol words, so tone and keying never depend on the
+ * CPU. The CPU only pushes words, refilled from pio0Irq0 when the FIFO
+ * has space */
+
+#ifndef PIO_TONE_H
+#define PIO_TONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scheduler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Symbol word format pushed to the state machine
+ * Bit 0: key down (1) or key up (0)
+ * Bits 31:1: number of tone periods minus one */
+#define PIO_TONE_WORD(down, periods) ((((uint32_t)(periods) - 1) << 1) | ((down) ? 1U : 0U))
+
+/* Load the program into PIO0 SM0 and start it, call after clocksInit()
+ * pin: GPIO driven with the tone
+ * toneHz: sidetone frequency
+ * ditUs: length of one dit unit in microseconds */
+void pioToneInit(uint32_t pin, uint32_t toneHz, uint32_t ditUs);
+
+/* Convert a scheduler symbol into a state machine word
+ * The length is rounded to whole tone periods, so every symbol of a
+ * given length is exactly the same number of PIO cycles */
+uint32_t pioToneWord(uint8_t symbol);
+
+/* Changes whenever pioToneInit sets new timing, so words built before
+ * can be told apart from current ones */
+uint32_t pioToneGeneration(void);
+
+/* Queue one symbol, returns false if the TX FIFO is full
+ * Not while the tone DMA runs, it feeds the same FIFO */
+bool pioTonePush(uint8_t symbol);
+
+/* Attach a symbol source (0 to detach), consulted from pio0Irq0 */
+void pioToneSetSource(schedulerSource source);
+
+/* Start refilling the FIFO from the attached source */
+void pioToneStart(void);
+
+/* True when the FIFO is empty and the state machine waits for a word */
+bool pioToneIdle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIO_TONE_H */
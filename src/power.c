@@ -0,0 +1,44 @@
+/* Power Manager
+ * DORMANT sequence (RP2040 datasheet section 2.11.5):
+ * 1. Move every clock onto the crystal and stop both PLLs
+ * 2. Arm the wake event and write the magic value to XOSC DORMANT
+ * 3. The crystal restarts on the event and the core resumes once it is
+ *    stable
+ * 4. Rebuild the PLLs and generators for the running profile */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "power.h"
+
+/* "coma", stops the crystal until a dormant wake event */
+#define XOSC_DORMANT_MAGIC 0x636f6d61
+
+#define XOSC_STATUS_STABLE (1U << 31)
+
+void powerInit(uint32_t extraEn0, uint32_t extraEn1)
+{
+    clocks->sleep_en0 = POWER_SLEEP_EN0 | extraEn0;
+    clocks->sleep_en1 = POWER_SLEEP_EN1 | extraEn1;
+    M0PLUS_SCR |= M0PLUS_SCR_SLEEPDEEP;
+}
+
+void powerDormant(uint32_t pin, uint32_t event, enum clockProfile profile)
+{
+    uint32_t shift = 4 * (pin % 8);
+    uint32_t primask = irqDisable();
+
+    clocksInit(CLOCK_PROFILE_XOSC);
+
+    io->intr[pin / 8] = 0xFU << shift;
+    io->dormant_wake_inte[pin / 8] |= event << shift;
+
+    xosc->dormant = XOSC_DORMANT_MAGIC;
+    while ((xosc->status & XOSC_STATUS_STABLE) == 0) {}
+
+    /* The edge woke the crystal, it is not a pending GPIO interrupt */
+    io->dormant_wake_inte[pin / 8] &= ~(event << shift);
+    io->intr[pin / 8] = 0xFU << shift;
+
+    clocksInit(profile);
+    irqRestore(primask);
+}
@@ -0,0 +1,52 @@
+/* Power Manager
+ * Two idle levels:
+ * sleep:   every wfi becomes a deep sleep, during which the clock
+ *          branches not listed in SLEEP_EN0/1 are gated. Branches come
+ *          back on at once when an interrupt wakes the core. The chip
+ *          only gates once both cores sleep deeply, so a build that
+ *          keeps core1 busy gets no gating
+ * dormant: the crystal itself is stopped until a GPIO edge. Only for
+ *          when nothing is queued, the TIMER does not count meanwhile
+ *
+ * After DORMANT the clocks are rebuilt by clocksInit() before any
+ * interrupt runs, so the first element after a wake is timed from a
+ * fully running TIMER */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+#include "clocks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Clock branches kept running in sleep by every build: bus fabric, SRAM,
+ * GPIO and pads (edge interrupts), SIO, TIMER and its watchdog tick */
+#define POWER_SLEEP_EN0 (CLK_EN0_SYS_CLOCKS | CLK_EN0_SYS_BUSCTRL | CLK_EN0_SYS_BUSFABRIC | \
+                         CLK_EN0_SYS_IO | CLK_EN0_SYS_VREG | CLK_EN0_SYS_PADS | \
+                         CLK_EN0_SYS_RESETS | CLK_EN0_SYS_SIO | CLK_EN0_SYS_SRAM0_3)
+#define POWER_SLEEP_EN1 (CLK_EN1_SYS_SRAM4_5 | CLK_EN1_SYS_SYSCFG | CLK_EN1_SYS_TIMER | \
+                         CLK_EN1_SYS_WATCHDOG | CLK_EN1_SYS_XOSC)
+
+/* Gate every clock branch outside POWER_SLEEP_EN0/1 and the extra ones
+ * in sleep and turn on deep sleep for this core
+ * extraEn0/1 list peripherals that must keep running while the core
+ * sleeps, such as a sidetone or DMA (CLK_EN0_ and CLK_EN1_ bits) */
+void powerInit(uint32_t extraEn0, uint32_t extraEn1);
+
+/* Stop the crystal until pin sees event (GPIO_INT_EDGE_LOW/HIGH), then
+ * restore the clocks for profile
+ * Runs with interrupts masked; the caller must check that no alarm or
+ * transfer is pending, anything timed is frozen while dormant */
+void powerDormant(uint32_t pin, uint32_t event, enum clockProfile profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_H */
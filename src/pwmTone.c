@@ -0,0 +1,126 @@
+/* PWM Sidetone
+ * The envelope position is kept in 8.8 fixed point so a ramp can span any
+ * whole number of tone periods. Between ramps the wrap interrupt is off;
+ * during a ramp each wrap costs one table load, one multiply and one
+ * compare register write */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "pwmTone.h"
+
+/* Raised-cosine envelope, (1 - cos(pi * i / 63)) / 2 in Q15 */
+#define ENVELOPE_STEPS 64
+#define ENVELOPE_MAX_POS ((ENVELOPE_STEPS - 1) << 8)
+
+static const uint16_t envelope[ENVELOPE_STEPS] = {
+        0,    20,    81,   183,   325,   507,   728,   988,
+     1286,  1622,  1995,  2404,  2847,  3324,  3833,  4374,
+     4944,  5543,  6169,  6820,  7495,  8192,  8909,  9645,
+    10398, 11166, 11946, 12738, 13539, 14346, 15159, 15975,
+    16792, 17608, 18421, 19228, 20029, 20821, 21601, 22369,
+    23122, 23858, 24575, 25272, 25947, 26598, 27224, 27823,
+    28393, 28934, 29443, 29920, 30363, 30772, 31145, 31481,
+    31779, 32039, 32260, 32442, 32584, 32686, 32747, 32767,
+};
+
+/* PWM register fields */
+#define PWM_CSR_EN          (1U << 0)
+#define PWM_DIV_INT(n)      ((n) << 4)
+
+static uint32_t toneSlice;          /* PWM slice of the speaker pin */
+static uint32_t toneShift;          /* 0 for channel A, 16 for channel B */
+static uint32_t fullDuty;           /* Compare value for 50% duty */
+static uint32_t rampLengthUs;       /* Requested rise/fall time */
+static int32_t envelopeStride;      /* Envelope steps per period, 8.8 */
+static int32_t envelopePos;         /* Current envelope position, 8.8 */
+static volatile bool rising;        /* Direction of the running ramp */
+
+void pwmToneSetFrequency(uint32_t toneHz)
+{
+    uint32_t cycles = hwDivide(clockGetHz(CLK_SYS), toneHz);
+
+    /* Smallest integer divider that keeps TOP within 16 bits */
+    uint32_t div = (cycles >> 16) + 1;
+    uint32_t top = hwDivide(cycles, div) - 1;
+
+    /* Ramp over a whole number of periods, at least one */
+    uint32_t rampPeriods = hwDivide(rampLengthUs * toneHz, 1000000U);
+    if (rampPeriods == 0) {
+        rampPeriods = 1;
+    }
+
+    uint32_t primask = irqDisable();
+    pwm->slice[toneSlice].div = PWM_DIV_INT(div);
+    pwm->slice[toneSlice].top = top;
+    fullDuty = (top + 1) >> 1;
+    envelopeStride = (int32_t)hwDivide(ENVELOPE_MAX_POS, rampPeriods);
+    if (envelopeStride == 0) {
+        envelopeStride = 1;
+    }
+    irqRestore(primask);
+}
+
+void pwmToneInit(uint32_t pin, uint32_t toneHz, uint32_t rampUs)
+{
+    RESETS_RESET &= ~RESET_PWM;
+    while ((RESETS_RESET_DONE & RESET_PWM) == 0) {}
+
+    toneSlice = (pin >> 1) & 7;
+    toneShift = (pin & 1) ? 16 : 0;
+    rampLengthUs = rampUs;
+    envelopePos = 0;
+
+    pwmToneSetFrequency(toneHz);
+    pwm->slice[toneSlice].cc = 0;
+    pwm->slice[toneSlice].csr = PWM_CSR_EN;
+
+    io->gpio[pin].ctrl = GPIO_FUNC_PWM;
+
+    pwm->intr = 1U << toneSlice;
+    NVIC_ISER = 1U << PWM_IRQ_WRAP;
+}
+
+void __not_in_flash_func(pwmToneKey)(bool down)
+{
+    rising = down;
+    pwm->inte |= 1U << toneSlice;
+}
+
+bool pwmToneIdle(void)
+{
+    return (pwm->inte & (1U << toneSlice)) == 0;
+}
+
+/* Interrupt handler for PWM wrap
+ * Overrides the weak alias in startup.c. Steps the envelope once per
+ * tone period and switches itself off when the ramp is complete. The
+ * new compare value is latched by the hardware at the next wrap */
+void __not_in_flash_func(pwmIrqWrap)(void)
+{
+    bool done = false;
+    int32_t pos;
+
+    pwm->intr = 1U << toneSlice;
+
+    if (rising) {
+        pos = envelopePos + envelopeStride;
+        if (pos >= ENVELOPE_MAX_POS) {
+            pos = ENVELOPE_MAX_POS;
+            done = true;
+        }
+    } else {
+        pos = envelopePos - envelopeStride;
+        if (pos <= 0) {
+            pos = 0;
+            done = true;
+        }
+    }
+    envelopePos = pos;
+
+    uint32_t duty = (fullDuty * envelope[pos >> 8]) >> 15;
+    pwm->slice[toneSlice].cc = duty << toneShift;
+
+    if (done) {
+        pwm->inte &= ~(1U << toneSlice);
+    }
+}
@@ -0,0 +1,38 @@
+/* PWM Sidetone
+ * Drives the speaker from its PWM slice at the tone frequency, keeping
+ * PIO free for other work. Key edges start a raised-cosine ramp of the
+ * duty cycle, stepped once per PWM period from pwmIrqWrap, which removes
+ * the clicks of hard on/off edges */
+
+#ifndef PWM_TONE_H
+#define PWM_TONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default rise and fall time in microseconds */
+#define PWM_TONE_RAMP_US 5000
+
+/* Route pin to its PWM slice and start the carrier at zero duty
+ * Call after clocksInit() */
+void pwmToneInit(uint32_t pin, uint32_t toneHz, uint32_t rampUs);
+
+/* Change the tone frequency, takes effect at the next period */
+void pwmToneSetFrequency(uint32_t toneHz);
+
+/* True once the last ramp has finished */
+bool pwmToneIdle(void);
+
+/* Start a rise (down) or fall (!down) ramp
+ * Matches schedulerKeyHook so the scheduler can key the tone directly */
+void pwmToneKey(bool down);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PWM_TONE_H */
@@ -0,0 +1,24 @@
+/* Register Init Tables
+ * Entries are applied strictly in order, so a table can rely on earlier
+ * entries, such as output levels cleared before the output enables */
+
+#include "rp2040.h"
+#include "regInit.h"
+
+void resetsRelease(uint32_t resetMask)
+{
+    RESETS_RESET &= ~resetMask;
+    while ((RESETS_RESET_DONE & resetMask) != resetMask) {}
+}
+
+void regInitApply(const struct regInit *table, uint32_t count)
+{
+    for (const struct regInit *entry = table; entry != table + count; entry++) {
+        volatile uint32_t *reg = (volatile uint32_t *)entry->addr;
+        if (entry->mask == REG_INIT_ALL) {
+            *reg = entry->value;
+        } else {
+            *reg = (*reg & ~entry->mask) | entry->value;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/* Register Init Tables
+ * Startup configuration as data: a const table of (register, mask,
+ * value) entries in .rodata, applied in order by one tight loop. Each
+ * entry stores value, or with a partial mask replaces only the masked
+ * bits. Table addresses are plain integers, so a table built from
+ * constants needs no relocation or startup copy.
+ *
+ * The REG_INIT_ helpers give the address of common GPIO registers. SIO
+ * set and clear registers take a whole pin mask in one entry */
+
+#ifndef REG_INIT_H
+#define REG_INIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rp2040.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct regInit {
+    uint32_t addr;
+    uint32_t mask;      /* Bits replaced, REG_INIT_ALL for a plain store */
+    uint32_t value;
+};
+
+/* Store without reading first, also for write-only SIO registers */
+#define REG_INIT_ALL 0xffffffffU
+
+#define REG_INIT_GPIO_CTRL(n) (IO_BANK0_BASE + offsetof(struct io_bank0_hw, gpio[n].ctrl))
+#define REG_INIT_PAD(n)       (PADS_BANK0_BASE + offsetof(struct pads_bank0_hw, gpio[n]))
+#define REG_INIT_SIO(field)   (SIO_BASE + offsetof(struct sio_hw, field))
+
+/* Take every block in resetMask out of reset with one write to RESETS,
+ * then wait once for all of them */
+void resetsRelease(uint32_t resetMask);
+
+/* Apply count entries of table in order */
+void regInitApply(const struct regInit *table, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REG_INIT_H */
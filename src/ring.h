@@ -0,0 +1,117 @@
+/* Lock-free Single-Producer Single-Consumer Ring
+ * Fixed capacity, power-of-two ring of 32-bit entries with caller-owned
+ * static storage. One context may push and one other context may pop
+ * without masking interrupts, including from interrupt handlers or from
+ * the other core.
+ *
+ * head and tail are free-running counters. Only the producer writes head
+ * and only the consumer writes tail, so each index has a single writer
+ * and no read-modify-write is ever shared. That is what makes the ring
+ * safe on the Cortex-M0+, which has no LDREX/STREX. A dmb orders the
+ * entry against the index that publishes it, which matters once the two
+ * sides run on different cores */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ring {
+    volatile uint32_t head; /* Entries pushed, written by the producer */
+    volatile uint32_t tail; /* Entries popped, written by the consumer */
+    uint32_t mask;          /* Capacity - 1 */
+    uint32_t *data;         /* Storage, capacity entries */
+};
+
+/* Define a ring with static storage
+ * Fails to compile unless size is a power of two */
+#define RING_DEFINE(name, size)                                                     \
+    typedef char name##SizeIsPowerOfTwo[(((size) & ((size) - 1)) == 0) ? 1 : -1]; \
+    static uint32_t name##Storage[size];                                            \
+    static struct ring name = { 0, 0, (size) - 1, name##Storage }
+
+/* Order memory accesses between the entry and its index */
+static inline void ringBarrier(void)
+{
+#if defined(HOST_SIM)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+    __asm volatile("dmb" ::: "memory");
+#endif
+}
+
+/* Number of entries waiting, callable from either side */
+static inline uint32_t ringCount(const struct ring *r)
+{
+    return r->head - r->tail;
+}
+
+static inline bool ringEmpty(const struct ring *r)
+{
+    return r->head == r->tail;
+}
+
+/* Free entries, callable from either side */
+static inline uint32_t ringSpace(const struct ring *r)
+{
+    return r->mask + 1 - (r->head - r->tail);
+}
+
+/* Producer side: append one entry, returns false if the ring is full */
+static inline bool ringPush(struct ring *r, uint32_t value)
+{
+    uint32_t head = r->head;
+
+    if (head - r->tail > r->mask) {
+        return false;
+    }
+    r->data[head & r->mask] = value;
+    ringBarrier();          /* Entry visible before the new head */
+    r->head = head + 1;
+    return true;
+}
+
+/* Consumer side: look at the oldest entry without removing it */
+static inline bool ringPeek(const struct ring *r, uint32_t *value)
+{
+    uint32_t tail = r->tail;
+
+    if (tail == r->head) {
+        return false;
+    }
+    ringBarrier();          /* Head read before the entry it publishes */
+    *value = r->data[tail & r->mask];
+    return true;
+}
+
+/* Consumer side: remove the oldest entry, returns false if empty */
+static inline bool ringPop(struct ring *r, uint32_t *value)
+{
+    uint32_t tail = r->tail;
+
+    if (tail == r->head) {
+        return false;
+    }
+    ringBarrier();          /* Head read before the entry it publishes */
+    *value = r->data[tail & r->mask];
+    ringBarrier();          /* Entry read before the slot is released */
+    r->tail = tail + 1;
+    return true;
+}
+
+/* Consumer side: drop every waiting entry */
+static inline void ringFlush(struct ring *r)
+{
+    r->tail = r->head;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RING_H */
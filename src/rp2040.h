@@ -0,0 +1,770 @@
+/* RP2040 Hardware Definitions
+ * Register layouts, base addresses and interrupt numbers shared by all
+ * firmware modules. Only the registers the firmware actually touches are
+ * described here
+ *
+ * HOST_SIM builds (make bench) keep the same layouts but point sio, io,
+ * pads, timer, the reset controller and the NVIC at plain memory that the
+ * host harness in bench/ defines and drives. Other peripherals are left
+ * undefined there, so only the hardware-independent modules build on the
+ * host */
+
+#ifndef RP2040_H
+#define RP2040_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Hardware Register Structures */
+/* SIO (Single-cycle IO) registers for fast GPIO access */
+struct sio_hw {
+    uint32_t cpuid;          /* Processor core identifier */
+    uint32_t gpio_in;        /* Input values for GPIO 0-29 */
+    uint32_t gpio_hi_in;     /* Input values for GPIO 30-35 */
+    uint32_t unused;         /* Reserved */
+    uint32_t gpio_out;       /* GPIO output values */
+    uint32_t gpio_out_set;   /* Set GPIO output bits */
+    uint32_t gpio_out_clr;   /* Clear GPIO output bits */
+    uint32_t gpio_out_xor;   /* XOR GPIO output bits */
+    uint32_t gpio_oe;        /* GPIO output enable */
+    uint32_t gpio_oe_set;    /* Set GPIO output enable bits */
+    uint32_t gpio_oe_clr;    /* Clear GPIO output enable bits */
+    uint32_t gpio_oe_xor;    /* XOR GPIO output enable bits */
+    uint32_t gpio_hi[8];     /* QSPI pin output and enable registers */
+    uint32_t fifo_st;        /* Inter-core FIFO status */
+    uint32_t fifo_wr;        /* Inter-core FIFO write */
+    uint32_t fifo_rd;        /* Inter-core FIFO read */
+    uint32_t spinlock_st;    /* Spinlock state */
+    uint32_t div_udividend;  /* Divider unsigned dividend */
+    uint32_t div_udivisor;   /* Divider unsigned divisor, starts division */
+    uint32_t div_sdividend;  /* Divider signed dividend */
+    uint32_t div_sdivisor;   /* Divider signed divisor, starts division */
+    uint32_t div_quotient;   /* Divider result quotient */
+    uint32_t div_remainder;  /* Divider result remainder */
+    uint32_t div_csr;        /* Divider status, bit 0 set when ready */
+    uint32_t reserved;       /* Reserved */
+    uint32_t interp[32];     /* Interpolators 0 and 1 */
+    uint32_t spinlock[32];   /* Read to claim (non-zero = claimed), write to release */
+};
+
+/* IO Bank 0 registers for GPIO configuration and interrupts */
+/* Each structure has two 32-bit values: status and ctrl */
+struct io_bank0_hw {
+    struct {
+        uint32_t status;     /* GPIO status */
+        uint32_t ctrl;       /* GPIO control including function selection */
+    } gpio[30];             /* We repeated this 30 times for each GPIO */
+    uint32_t intr[4];       /* Raw interrupts */
+    uint32_t proc0_inte[4]; /* Interrupt enable for processor 0 */
+    uint32_t proc0_intf[4]; /* Interrupt force for processor 0 */
+    uint32_t proc0_ints[4]; /* Interrupt status for processor 0 */
+    uint32_t proc1_inte[4]; /* Interrupt enable for processor 1 */
+    uint32_t proc1_intf[4]; /* Interrupt force for processor 1 */
+    uint32_t proc1_ints[4]; /* Interrupt status for processor 1 */
+    uint32_t dormant_wake_inte[4]; /* Events that wake the XOSC from DORMANT */
+    uint32_t dormant_wake_intf[4];
+    uint32_t dormant_wake_ints[4];
+};
+
+/* Pad control registers for GPIO electrical properties */
+struct pads_bank0_hw {
+    uint32_t voltage_select; /* Voltage select */
+    uint32_t gpio[30];      /* Pad control register for each GPIO */
+    uint32_t swclk;         /* Pad control register for SWCLK */
+    uint32_t swd;           /* Pad control register for SWD */
+};
+
+/* Pad control bits */
+#define PADS_GPIO_SLEWFAST  (1U << 0)   /* Fast output slew rate */
+#define PADS_GPIO_SCHMITT   (1U << 1)   /* Schmitt trigger on the input */
+#define PADS_GPIO_PDE       (1U << 2)   /* Pull-down enable */
+#define PADS_GPIO_PUE       (1U << 3)   /* Pull-up enable */
+#define PADS_GPIO_IE        (1U << 6)   /* Input enable */
+#define PADS_GPIO_OD        (1U << 7)   /* Output disable, overrides the SIO enable */
+
+/* TIMER registers
+ * A 64-bit microsecond counter with four 32-bit alarms, each wired to its
+ * own interrupt line (TIMER_IRQ_0..3) */
+struct timer_hw {
+    uint32_t timehw;        /* Write high word of time (after timelw) */
+    uint32_t timelw;        /* Write low word of time */
+    uint32_t timehr;        /* Read high word of time (latched by timelr) */
+    uint32_t timelr;        /* Read low word of time */
+    uint32_t alarm[4];      /* Arm alarm n, fires when timelr matches */
+    uint32_t armed;         /* Alarm armed status, write 1 to disarm */
+    uint32_t timerawh;      /* Raw high word of time, no side effects */
+    uint32_t timerawl;      /* Raw low word of time, no side effects */
+    uint32_t dbgpause;      /* Pause timer while a core is in debug */
+    uint32_t pause;         /* Pause the timer */
+    uint32_t intr;          /* Raw interrupts, write 1 to clear */
+    uint32_t inte;          /* Interrupt enable */
+    uint32_t intf;          /* Interrupt force */
+    uint32_t ints;          /* Interrupt status after masking and forcing */
+};
+
+/* Clock generator registers
+ * Each generator has a control, divider and selected-source register,
+ * indexed by enum clockId in clocks.h */
+struct clocks_hw {
+    struct {
+        uint32_t ctrl;      /* Source selection and enable */
+        uint32_t div;       /* Integer divider in bits 31:8, fraction in 7:0 */
+        uint32_t selected;  /* One-hot glitchless source status (ref, sys) */
+    } clk[10];
+    uint32_t resus_ctrl;    /* clk_sys resuscitation control */
+    uint32_t resus_status;  /* clk_sys resuscitation status */
+    uint32_t fc0[8];        /* Frequency counter */
+    uint32_t wake_en0;      /* Clocks enabled while awake, bank 0 */
+    uint32_t wake_en1;      /* Clocks enabled while awake, bank 1 */
+    uint32_t sleep_en0;     /* Clocks kept running in sleep, bank 0 */
+    uint32_t sleep_en1;     /* Clocks kept running in sleep, bank 1 */
+    uint32_t enabled0;      /* Clock enable status, bank 0 */
+    uint32_t enabled1;      /* Clock enable status, bank 1 */
+    uint32_t intr;          /* Raw interrupts */
+    uint32_t inte;          /* Interrupt enable */
+    uint32_t intf;          /* Interrupt force */
+    uint32_t ints;          /* Interrupt status after masking and forcing */
+};
+
+/* Clock branches in wake_en0 / sleep_en0 (the ones this firmware names) */
+#define CLK_EN0_SYS_CLOCKS      (1U << 0)
+#define CLK_EN0_ADC_ADC         (1U << 1)
+#define CLK_EN0_SYS_ADC         (1U << 2)
+#define CLK_EN0_SYS_BUSCTRL     (1U << 3)
+#define CLK_EN0_SYS_BUSFABRIC   (1U << 4)
+#define CLK_EN0_SYS_DMA         (1U << 5)
+#define CLK_EN0_SYS_IO          (1U << 8)
+#define CLK_EN0_SYS_VREG        (1U << 10)
+#define CLK_EN0_SYS_PADS        (1U << 11)
+#define CLK_EN0_SYS_PIO0        (1U << 12)
+#define CLK_EN0_SYS_PWM         (1U << 17)
+#define CLK_EN0_SYS_RESETS      (1U << 18)
+#define CLK_EN0_RTC_RTC         (1U << 21)
+#define CLK_EN0_SYS_RTC         (1U << 22)
+#define CLK_EN0_SYS_SIO         (1U << 23)
+#define CLK_EN0_SYS_SRAM0_3     (0xfU << 28)
+/* ... and in wake_en1 / sleep_en1 */
+#define CLK_EN1_SYS_SRAM4_5     (3U << 0)
+#define CLK_EN1_SYS_SYSCFG      (1U << 2)
+#define CLK_EN1_SYS_TIMER       (1U << 5)
+#define CLK_EN1_PERI_UART0      (1U << 6)
+#define CLK_EN1_SYS_UART0       (1U << 7)
+#define CLK_EN1_SYS_USBCTRL     (1U << 10)
+#define CLK_EN1_USB_USBCTRL     (1U << 11)
+#define CLK_EN1_SYS_WATCHDOG    (1U << 12)
+#define CLK_EN1_SYS_XOSC        (1U << 14)
+
+/* Crystal oscillator registers */
+struct xosc_hw {
+    uint32_t ctrl;          /* Frequency range and enable */
+    uint32_t status;        /* Stable flag in bit 31 */
+    uint32_t dormant;       /* Write the dormant magic value to stop */
+    uint32_t startup;       /* Startup delay in units of 256 XOSC cycles */
+    uint32_t reserved[3];
+    uint32_t count;         /* Down counter running at XOSC frequency */
+};
+
+/* PLL registers (PLL_SYS and PLL_USB share the layout) */
+struct pll_hw {
+    uint32_t cs;            /* Lock status and reference divider */
+    uint32_t pwr;           /* Power down controls */
+    uint32_t fbdiv_int;     /* VCO feedback divider */
+    uint32_t prim;          /* Post dividers 1 and 2 */
+};
+
+/* PIO registers
+ * Four state machines sharing a 32-instruction memory. Each state machine
+ * has its own TX/RX FIFO and configuration block */
+struct pio_sm_hw {
+    uint32_t clkdiv;        /* Clock divider, integer in bits 31:16 */
+    uint32_t execctrl;      /* Wrap addresses and jmp pin */
+    uint32_t shiftctrl;     /* Shift directions, thresholds and FIFO join */
+    uint32_t addr;          /* Current program counter */
+    uint32_t instr;         /* Write to execute an instruction immediately */
+    uint32_t pinctrl;       /* Pin mapping for out, set, side-set and in */
+};
+
+struct pio_hw {
+    uint32_t ctrl;          /* State machine enable and restart */
+    uint32_t fstat;         /* FIFO full and empty flags */
+    uint32_t fdebug;        /* FIFO stall and overflow flags */
+    uint32_t flevel;        /* FIFO levels */
+    uint32_t txf[4];        /* TX FIFO write ports */
+    uint32_t rxf[4];        /* RX FIFO read ports */
+    uint32_t irq;           /* State machine IRQ flags */
+    uint32_t irq_force;     /* Force state machine IRQ flags */
+    uint32_t input_sync_bypass;
+    uint32_t dbg_padout;
+    uint32_t dbg_padoe;
+    uint32_t dbg_cfginfo;
+    uint32_t instr_mem[32]; /* Instruction memory, write only */
+    struct pio_sm_hw sm[4];
+    uint32_t intr;          /* Raw interrupts */
+    uint32_t irq0_inte;     /* Interrupt enable for PIOx_IRQ_0 */
+    uint32_t irq0_intf;     /* Interrupt force for PIOx_IRQ_0 */
+    uint32_t irq0_ints;     /* Interrupt status for PIOx_IRQ_0 */
+    uint32_t irq1_inte;     /* Interrupt enable for PIOx_IRQ_1 */
+    uint32_t irq1_intf;     /* Interrupt force for PIOx_IRQ_1 */
+    uint32_t irq1_ints;     /* Interrupt status for PIOx_IRQ_1 */
+};
+
+/* DMA registers
+ * Twelve channels, each with four aliased register layouts so that any
+ * one of them can be written last to trigger the channel */
+struct dma_channel_hw {
+    uint32_t read_addr;
+    uint32_t write_addr;
+    uint32_t transfer_count;
+    uint32_t ctrl_trig;                 /* Control, writing triggers */
+    uint32_t al1_ctrl;                  /* Control, no trigger */
+    uint32_t al1_read_addr;
+    uint32_t al1_write_addr;
+    uint32_t al1_transfer_count_trig;
+    uint32_t al2_ctrl;
+    uint32_t al2_transfer_count;
+    uint32_t al2_read_addr;
+    uint32_t al2_write_addr_trig;
+    uint32_t al3_ctrl;
+    uint32_t al3_write_addr;
+    uint32_t al3_transfer_count;
+    uint32_t al3_read_addr_trig;        /* Read address, writing triggers */
+};
+
+struct dma_hw {
+    struct dma_channel_hw ch[12];
+    uint32_t reserved0[64];
+    uint32_t intr;          /* Raw interrupts, one bit per channel */
+    uint32_t inte0;         /* Interrupt enable for DMA_IRQ_0 */
+    uint32_t intf0;         /* Interrupt force for DMA_IRQ_0 */
+    uint32_t ints0;         /* Interrupt status for DMA_IRQ_0, write 1 to clear */
+    uint32_t reserved1;
+    uint32_t inte1;         /* Interrupt enable for DMA_IRQ_1 */
+    uint32_t intf1;         /* Interrupt force for DMA_IRQ_1 */
+    uint32_t ints1;         /* Interrupt status for DMA_IRQ_1, write 1 to clear */
+    uint32_t timer[4];      /* Pacing timers */
+    uint32_t multi_chan_trigger;
+    uint32_t sniff_ctrl;
+    uint32_t sniff_data;
+    uint32_t reserved2;
+    uint32_t fifo_levels;
+    uint32_t chan_abort;    /* Write 1 to abort a channel */
+};
+
+/* DMA channel control fields */
+#define DMA_CTRL_EN                 (1U << 0)
+#define DMA_CTRL_HIGH_PRIORITY      (1U << 1)
+#define DMA_CTRL_DATA_SIZE_BYTE     (0U << 2)
+#define DMA_CTRL_DATA_SIZE_HALFWORD (1U << 2)
+#define DMA_CTRL_DATA_SIZE_WORD     (2U << 2)
+#define DMA_CTRL_INCR_READ          (1U << 4)
+#define DMA_CTRL_INCR_WRITE         (1U << 5)
+#define DMA_CTRL_RING_SIZE(bits)    ((bits) << 6)
+#define DMA_CTRL_RING_SEL_WRITE     (1U << 10)
+#define DMA_CTRL_CHAIN_TO(ch)       ((ch) << 11)
+#define DMA_CTRL_TREQ_SEL(dreq)     ((dreq) << 15)
+#define DMA_CTRL_IRQ_QUIET          (1U << 21)
+#define DMA_CTRL_BUSY               (1U << 24)
+
+/* DMA request sources */
+#define DREQ_PIO0_TX0   0
+#define DREQ_UART0_RX   21
+#define DREQ_ADC        36
+#define DREQ_FORCE      0x3f    /* Unpaced, as fast as possible */
+
+/* PWM registers
+ * Eight slices, each driving the A/B channels of two adjacent GPIOs
+ * GPIO n belongs to slice (n >> 1) & 7, channel n & 1 (0 = A, 1 = B) */
+struct pwm_slice_hw {
+    uint32_t csr;           /* Enable and mode */
+    uint32_t div;           /* Clock divider, integer 11:4, fraction 3:0 */
+    uint32_t ctr;           /* Counter */
+    uint32_t cc;            /* Compare values, A in 15:0, B in 31:16 */
+    uint32_t top;           /* Wrap value */
+};
+
+struct pwm_hw {
+    struct pwm_slice_hw slice[8];
+    uint32_t en;            /* Enable all slices at once */
+    uint32_t intr;          /* Raw wrap interrupts, write 1 to clear */
+    uint32_t inte;          /* Wrap interrupt enable per slice */
+    uint32_t intf;          /* Interrupt force */
+    uint32_t ints;          /* Interrupt status after masking and forcing */
+};
+
+/* UART registers (ARM PL011)
+ * Baud rate divisor is clk_peri / (16 * baud) as a 16.6 fixed point
+ * value in ibrd/fbrd, latched by the following write to lcr_h */
+struct uart_hw {
+    uint32_t dr;            /* Data, reads pop the RX FIFO */
+    uint32_t rsr;           /* Receive status and error clear */
+    uint32_t reserved0[4];
+    uint32_t fr;            /* Flags */
+    uint32_t reserved1;
+    uint32_t ilpr;          /* IrDA low-power counter */
+    uint32_t ibrd;          /* Integer baud rate divisor */
+    uint32_t fbrd;          /* Fractional baud rate divisor */
+    uint32_t lcr_h;         /* Line control */
+    uint32_t cr;            /* Control */
+    uint32_t ifls;          /* Interrupt FIFO level select */
+    uint32_t imsc;          /* Interrupt mask set/clear */
+    uint32_t ris;           /* Raw interrupt status */
+    uint32_t mis;           /* Masked interrupt status */
+    uint32_t icr;           /* Interrupt clear */
+    uint32_t dmacr;         /* DMA control */
+};
+
+#define UART_FR_RXFE        (1U << 4)   /* RX FIFO empty */
+#define UART_FR_TXFF        (1U << 5)   /* TX FIFO full */
+#define UART_LCR_H_FEN      (1U << 4)   /* Enable FIFOs */
+#define UART_LCR_H_WLEN_8   (3U << 5)   /* 8 data bits */
+#define UART_CR_UARTEN      (1U << 0)
+#define UART_CR_TXE         (1U << 8)
+#define UART_CR_RXE         (1U << 9)
+#define UART_CR_RTSEN       (1U << 14)  /* Hardware RTS from the RX FIFO level */
+#define UART_INT_RX         (1U << 4)   /* RX FIFO level reached */
+#define UART_INT_RT         (1U << 6)   /* RX timeout, FIFO not empty and line idle */
+#define UART_DMACR_RXDMAE   (1U << 0)
+
+/* Real-time clock registers
+ * Counts a calendar date and time from clk_rtc, divided down to 1 Hz by
+ * clkdiv_m1 + 1. The alarm compares every field with its _ENA bit set
+ * against the running time and raises the interrupt while they match */
+struct rtc_hw {
+    uint32_t clkdiv_m1;     /* clk_rtc cycles per second, minus one */
+    uint32_t setup_0;       /* Date to load: year, month, day */
+    uint32_t setup_1;       /* Time to load: day of week, hour, min, sec */
+    uint32_t ctrl;
+    uint32_t irq_setup_0;   /* Alarm date fields and match enable */
+    uint32_t irq_setup_1;   /* Alarm time fields */
+    uint32_t rtc_1;         /* Running date, read after rtc_0 */
+    uint32_t rtc_0;         /* Running time, reading it latches rtc_1 */
+    uint32_t intr;          /* Raw interrupt */
+    uint32_t inte;          /* Interrupt enable */
+    uint32_t intf;          /* Interrupt force */
+    uint32_t ints;          /* Interrupt status after masking and forcing */
+};
+
+#define RTC_CTRL_ENABLE       (1U << 0)
+#define RTC_CTRL_ACTIVE       (1U << 1)   /* Running, follows ENABLE in the slow clock domain */
+#define RTC_CTRL_LOAD         (1U << 4)   /* Load setup_0/1 into the counters */
+#define RTC_DATE(year, month, day) ((uint32_t)(year) << 12 | (uint32_t)(month) << 8 | (uint32_t)(day))
+#define RTC_TIME(hour, min, sec)   ((uint32_t)(hour) << 16 | (uint32_t)(min) << 8 | (uint32_t)(sec))
+#define RTC_TIME_HOUR(t)      (((t) >> 16) & 0x1fU)
+#define RTC_TIME_MIN(t)       (((t) >> 8) & 0x3fU)
+#define RTC_TIME_SEC(t)       ((t) & 0x3fU)
+#define RTC_IRQ_MATCH_ENA     (1U << 28)  /* irq_setup_0: alarm armed */
+#define RTC_IRQ_MATCH_ACTIVE  (1U << 29)  /* irq_setup_0: MATCH_ENA as seen by the slow clock domain */
+#define RTC_IRQ_SEC_ENA       (1U << 28)  /* irq_setup_1: compare seconds */
+#define RTC_IRQ_MIN_ENA       (1U << 29)  /* irq_setup_1: compare minutes */
+#define RTC_IRQ_HOUR_ENA      (1U << 30)  /* irq_setup_1: compare hours */
+#define RTC_INT_ALARM         (1U << 0)
+
+/* ADC registers
+ * One 12-bit converter behind a 4-sample FIFO and a 5-input mux, AIN0-3
+ * on GPIO26-29. In free-running mode a conversion starts every
+ * 1 + div cycles of the 48 MHz clk_adc, div in 16.8 fixed point */
+struct adc_hw {
+    uint32_t cs;            /* Control and status */
+    uint32_t result;        /* Last conversion */
+    uint32_t fcs;           /* FIFO control and status */
+    uint32_t fifo;          /* FIFO, reads pop */
+    uint32_t div;           /* Free-running sample period */
+    uint32_t intr;          /* Raw interrupts */
+    uint32_t inte;          /* Interrupt enable */
+    uint32_t intf;          /* Interrupt force */
+    uint32_t ints;          /* Interrupt status after masking and forcing */
+};
+
+#define ADC_CS_EN             (1U << 0)
+#define ADC_CS_START_MANY     (1U << 3)   /* Free-running */
+#define ADC_CS_READY          (1U << 8)
+#define ADC_CS_AINSEL(n)      ((uint32_t)(n) << 12)
+#define ADC_FCS_EN            (1U << 0)   /* Conversions go to the FIFO */
+#define ADC_FCS_SHIFT         (1U << 1)   /* Keep the top 8 bits only */
+#define ADC_FCS_DREQ_EN       (1U << 3)
+#define ADC_FCS_UNDER         (1U << 10)  /* Sticky, write 1 to clear */
+#define ADC_FCS_OVER          (1U << 11)  /* Sticky, write 1 to clear */
+#define ADC_FCS_THRESH(n)     ((uint32_t)(n) << 24)
+#define ADC_FIRST_PIN         26          /* AIN0 */
+
+/* USB controller registers (device mode subset in use) */
+struct usb_hw {
+    uint32_t addr_endp;             /* Device address in 6:0 */
+    uint32_t addr_endp_host[15];    /* Host mode only */
+    uint32_t main_ctrl;
+    uint32_t sof_wr;
+    uint32_t sof_rd;
+    uint32_t sie_ctrl;
+    uint32_t sie_status;            /* Write 1 to clear */
+    uint32_t int_ep_ctrl;
+    uint32_t buff_status;           /* Bit 2n EPn IN, 2n + 1 EPn OUT, write 1 to clear */
+    uint32_t buff_cpu_should_handle;
+    uint32_t abort;
+    uint32_t abort_done;
+    uint32_t ep_stall_arm;          /* Bit 0 EP0 IN, bit 1 EP0 OUT */
+    uint32_t nak_poll;
+    uint32_t ep_status_stall_nak;
+    uint32_t muxing;
+    uint32_t pwr;
+    uint32_t phy_direct;
+    uint32_t phy_direct_override;
+    uint32_t phy_trim;
+    uint32_t linestate_tuning;
+    uint32_t intr;
+    uint32_t inte;
+    uint32_t intf;
+    uint32_t ints;
+};
+
+/* USB dual-port RAM, 4 KB shared with the controller
+ * Endpoint buffers must be 64-byte aligned and are addressed by their
+ * offset from the start of the DPRAM */
+struct usb_dpram {
+    uint8_t setup[8];               /* Last SETUP packet */
+    struct {
+        uint32_t in;
+        uint32_t out;
+    } ep_ctrl[15];                  /* EP1-EP15 endpoint control */
+    struct {
+        uint32_t in;
+        uint32_t out;
+    } ep_buf_ctrl[16];              /* EP0-EP15 buffer control */
+    uint8_t ep0_buf[64];            /* Shared EP0 IN/OUT buffer */
+    uint8_t ep0_buf_b[64];
+    uint8_t data[4096 - 0x180];     /* Buffers for the other endpoints */
+};
+
+#define USB_MAIN_CTRL_CONTROLLER_EN (1U << 0)
+#define USB_SIE_CTRL_PULLUP_EN      (1U << 16)
+#define USB_SIE_CTRL_EP0_INT_1BUF   (1U << 29)
+#define USB_SIE_STATUS_SETUP_REC    (1U << 17)
+#define USB_SIE_STATUS_BUS_RESET    (1U << 19)
+#define USB_MUXING_TO_PHY           (1U << 0)
+#define USB_MUXING_SOFTCON          (1U << 3)
+#define USB_PWR_VBUS_DETECT         (1U << 2)
+#define USB_PWR_VBUS_DETECT_OVERRIDE_EN (1U << 3)
+#define USB_INT_BUFF_STATUS         (1U << 4)
+#define USB_INT_BUS_RESET           (1U << 12)
+#define USB_INT_SETUP_REQ           (1U << 16)
+
+/* Endpoint control and buffer control fields */
+#define USB_EP_ENABLE               (1U << 31)
+#define USB_EP_INTERRUPT_PER_BUFFER (1U << 29)
+#define USB_EP_TYPE_BULK            (2U << 26)
+#define USB_EP_TYPE_INTERRUPT       (3U << 26)
+#define USB_BUF_FULL                (1U << 15)
+#define USB_BUF_LAST                (1U << 14)
+#define USB_BUF_DATA1               (1U << 13)
+#define USB_BUF_STALL               (1U << 11)
+#define USB_BUF_AVAILABLE           (1U << 10)
+#define USB_BUF_LEN_MASK            0x3ffU
+
+/* Base addresses for hardware registers */
+#define XIP_BASE        0x10000000
+#define SIO_BASE        0xd0000000
+#define IO_BANK0_BASE   0x40014000
+#define PADS_BANK0_BASE 0x4001c000
+#define RESETS_BASE     0x4000c000
+#define WATCHDOG_BASE   0x40058000
+#define PSM_BASE        0x40010000
+#define TIMER_BASE      0x40054000
+#define CLOCKS_BASE     0x40008000
+#define XOSC_BASE       0x40024000
+#define PLL_SYS_BASE    0x40028000
+#define PLL_USB_BASE    0x4002c000
+#define PIO0_BASE       0x50200000
+#define PIO1_BASE       0x50300000
+#define DMA_BASE        0x50000000
+#define PWM_BASE        0x40050000
+#define UART0_BASE      0x40034000
+#define UART1_BASE      0x40038000
+#define RTC_BASE        0x4005c000
+#define ADC_BASE        0x4004c000
+#define USBCTRL_DPRAM_BASE 0x50100000
+#define USBCTRL_REGS_BASE  0x50110000
+
+/* Register access pointers */
+#if defined(HOST_SIM)
+extern volatile struct sio_hw simSio;
+extern volatile struct io_bank0_hw simIo;
+extern volatile struct pads_bank0_hw simPads;
+extern volatile struct timer_hw simTimer;
+#define sio   (&simSio)
+#define io    (&simIo)
+#define pads  (&simPads)
+#define timer (&simTimer)
+#else
+#define sio  ((volatile struct sio_hw*)SIO_BASE)
+/* This line means:
+   1. Take SIO_BASE address (0xd0000000)
+   2. Cast it to a pointer to struct sio_hw
+   3. Make it volatile (tells compiler value can change unexpectedly)
+   4. Store in variable 'sio' */
+#define io    ((volatile struct io_bank0_hw*)IO_BANK0_BASE)
+#define pads  ((volatile struct pads_bank0_hw*)PADS_BANK0_BASE)
+#define timer ((volatile struct timer_hw*)TIMER_BASE)
+#define clocks  ((volatile struct clocks_hw*)CLOCKS_BASE)
+#define xosc    ((volatile struct xosc_hw*)XOSC_BASE)
+#define pll_sys ((volatile struct pll_hw*)PLL_SYS_BASE)
+#define pll_usb ((volatile struct pll_hw*)PLL_USB_BASE)
+#define pio0    ((volatile struct pio_hw*)PIO0_BASE)
+#define pio1    ((volatile struct pio_hw*)PIO1_BASE)
+#define dma     ((volatile struct dma_hw*)DMA_BASE)
+#define pwm     ((volatile struct pwm_hw*)PWM_BASE)
+#define uart0   ((volatile struct uart_hw*)UART0_BASE)
+#define uart1   ((volatile struct uart_hw*)UART1_BASE)
+#define rtc     ((volatile struct rtc_hw*)RTC_BASE)
+#define adc     ((volatile struct adc_hw*)ADC_BASE)
+#define usb     ((volatile struct usb_hw*)USBCTRL_REGS_BASE)
+#define usbDpram ((volatile struct usb_dpram*)USBCTRL_DPRAM_BASE)
+#endif
+
+/* Reset controller
+ * A peripheral is held in reset while its bit in RESETS_RESET is set and
+ * is usable once the same bit reads back as set in RESETS_RESET_DONE */
+#if defined(HOST_SIM)
+extern volatile uint32_t simResets[3];      /* RESET, WDSEL, RESET_DONE */
+#define RESETS_RESET      simResets[0]
+#define RESETS_RESET_DONE simResets[2]
+#else
+#define RESETS_RESET      (*(volatile uint32_t*)(RESETS_BASE + 0x0))
+#define RESETS_RESET_DONE (*(volatile uint32_t*)(RESETS_BASE + 0x8))
+#endif
+#define RESET_ADC         (1U << 0)
+#define RESET_DMA         (1U << 2)
+#define RESET_IO_BANK0    (1U << 5)
+#define RESET_PADS_BANK0  (1U << 8)
+#define RESET_PIO0        (1U << 10)
+#define RESET_PIO1        (1U << 11)
+#define RESET_PLL_SYS     (1U << 12)
+#define RESET_PLL_USB     (1U << 13)
+#define RESET_PWM         (1U << 14)
+#define RESET_RTC         (1U << 15)
+#define RESET_TIMER       (1U << 21)
+#define RESET_UART0       (1U << 22)
+#define RESET_UART1       (1U << 23)
+#define RESET_USBCTRL     (1U << 24)
+
+/* Watchdog tick generator
+ * Divides clk_ref down to the 1 us tick that clocks the TIMER */
+#define WATCHDOG_TICK         (*(volatile uint32_t*)(WATCHDOG_BASE + 0x2c))
+#define WATCHDOG_TICK_ENABLE  (1U << 9)
+
+/* Watchdog counter
+ * Counts down from LOAD once enabled and resets the chip at zero, or at
+ * once on TRIGGER. REASON tells the next boot which of the two it was,
+ * both bits are clear after a power-on or RUN pin reset. The scratch
+ * registers survive every reset but those. Erratum RP2040-E1: the
+ * counter drops by 2 per tick, so LOAD is twice the time in us */
+#define WATCHDOG_CTRL         (*(volatile uint32_t*)(WATCHDOG_BASE + 0x00))
+#define WATCHDOG_LOAD         (*(volatile uint32_t*)(WATCHDOG_BASE + 0x04))
+#define WATCHDOG_REASON       (*(volatile uint32_t*)(WATCHDOG_BASE + 0x08))
+#define WATCHDOG_SCRATCH(n)   (*(volatile uint32_t*)(WATCHDOG_BASE + 0x0c + 4 * (n)))
+#define WATCHDOG_CTRL_PAUSE_JTAG (1U << 24)
+#define WATCHDOG_CTRL_PAUSE_DBG0 (1U << 25)
+#define WATCHDOG_CTRL_PAUSE_DBG1 (1U << 26)
+#define WATCHDOG_CTRL_ENABLE  (1U << 30)
+#define WATCHDOG_CTRL_TRIGGER (1U << 31)
+#define WATCHDOG_LOAD_MAX     0x00ffffffU
+#define WATCHDOG_REASON_TIMER (1U << 0)
+#define WATCHDOG_REASON_FORCE (1U << 1)
+
+/* Power-on state machine
+ * A block with its bit in WDSEL is reset along with the cores by the
+ * watchdog. All but the oscillators, so the clocks restart cleanly */
+#define PSM_WDSEL       (*(volatile uint32_t*)(PSM_BASE + 0x8))
+#define PSM_WDSEL_ROSC  (1U << 0)
+#define PSM_WDSEL_XOSC  (1U << 1)
+#define PSM_WDSEL_ALL   0x0001ffffU
+
+/* Start of flash as XIP maps it, the flash routines count offsets from
+ * here. HOST_SIM: an image of SIM_FLASH_BYTES in host memory, ending in
+ * the SIM_STORE_BYTES of the store region (rp2040.ld) */
+#if defined(HOST_SIM)
+#define SIM_FLASH_BYTES (68U * 1024U)
+#define SIM_STORE_BYTES (64U * 1024U)
+extern uint8_t simFlash[SIM_FLASH_BYTES];
+#define XIP_FLASH ((const uint8_t *)simFlash)
+#else
+#define XIP_FLASH ((const uint8_t *)XIP_BASE)
+#endif
+
+/* SRAM, the striped banks 0-3 and the two 4 KB banks above them */
+#define SRAM_BASE       0x20000000
+#define SRAM_END        0x20042000
+
+/* Bootrom function table
+ * Halfword pointers at fixed ROM addresses lead to the function table and
+ * the routine that looks a function up by its two-letter code */
+#define ROM_FUNC_TABLE    (*(const volatile uint16_t*)(0x00000014))
+#define ROM_TABLE_LOOKUP  (*(const volatile uint16_t*)(0x00000018))
+#define ROM_CODE(c1, c2)  ((uint32_t)(c1) | ((uint32_t)(c2) << 8))
+
+typedef void *(*romTableLookupFunc)(const uint16_t *table, uint32_t code);
+
+#if defined(HOST_SIM)
+/* The bench's flash routines, working on its flash image */
+void *simRomFuncLookup(uint32_t code);
+
+static inline void *romFuncLookup(uint32_t code)
+{
+    return simRomFuncLookup(code);
+}
+#else
+/* GCC takes reads this close to address 0 for null pointer accesses */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+static inline void *romFuncLookup(uint32_t code)
+{
+    romTableLookupFunc lookup = (romTableLookupFunc)(uintptr_t)ROM_TABLE_LOOKUP;
+    return lookup((const uint16_t *)(uintptr_t)ROM_FUNC_TABLE, code);
+}
+#pragma GCC diagnostic pop
+#endif
+
+/* Flash routines, called with XIP disabled (flash_exit_xip) from SRAM */
+#define ROM_FLASH_CONNECT   ROM_CODE('I', 'F')  /* connect_internal_flash */
+#define ROM_FLASH_EXIT_XIP  ROM_CODE('E', 'X')  /* flash_exit_xip */
+#define ROM_FLASH_ERASE     ROM_CODE('R', 'E')  /* flash_range_erase */
+#define ROM_FLASH_PROGRAM   ROM_CODE('R', 'P')  /* flash_range_program */
+#define ROM_FLASH_FLUSH     ROM_CODE('F', 'C')  /* flash_flush_cache */
+
+typedef void (*romVoidFunc)(void);
+typedef void (*romFlashEraseFunc)(uint32_t offset, uint32_t count, uint32_t blockSize, uint8_t blockCmd);
+typedef void (*romFlashProgramFunc)(uint32_t offset, const uint8_t *data, uint32_t count);
+
+/* GPIO function select and interrupt event bits */
+#define GPIO_FUNC_UART      2   /* UART function for GPIO */
+#define GPIO_FUNC_PWM       4   /* PWM function for GPIO */
+#define GPIO_FUNC_SIO       5   /* SIO function for GPIO */
+#define GPIO_FUNC_PIO0      6   /* PIO0 function for GPIO */
+#define GPIO_FUNC_PIO1      7   /* PIO1 function for GPIO */
+#define GPIO_FUNC_NULL      0x1f    /* No function, for analogue inputs */
+#define GPIO_INT_LEVEL_LOW  0x1
+#define GPIO_INT_LEVEL_HIGH 0x2
+#define GPIO_INT_EDGE_LOW   0x4
+#define GPIO_INT_EDGE_HIGH  0x8
+
+/* Interrupt numbers, matching the order of the vector table in startup.c */
+#define TIMER_IRQ_0   0
+#define TIMER_IRQ_1   1
+#define TIMER_IRQ_2   2
+#define TIMER_IRQ_3   3
+#define PWM_IRQ_WRAP  4
+#define USBCTRL_IRQ   5
+#define PIO0_IRQ_0    7
+#define PIO1_IRQ_0    9
+#define DMA_IRQ_0    11
+#define DMA_IRQ_1    12
+#define IO_BANK0_IRQ 13    /* IO Bank 0 interrupt number */
+#define SIO_IRQ_PROC0 15
+#define SIO_IRQ_PROC1 16
+#define UART0_IRQ    20
+#define RTC_IRQ      25
+
+/* Inter-core FIFO status bits */
+#define SIO_FIFO_ST_VLD  (1U << 0)  /* Read FIFO has data */
+#define SIO_FIFO_ST_RDY  (1U << 1)  /* Write FIFO has space */
+#define SIO_FIFO_ST_WOF  (1U << 2)  /* Write overflow, sticky */
+#define SIO_FIFO_ST_ROE  (1U << 3)  /* Read underflow, sticky */
+#define SIO_FIFO_DEPTH   8          /* Words each direction holds */
+
+/* ARM Cortex-M0+ core registers, private to each core */
+#define M0PLUS_VTOR (*(volatile uint32_t*)(0xe000ed08))
+#define M0PLUS_SCR  (*(volatile uint32_t*)(0xe000ed10))
+#define M0PLUS_SCR_SLEEPDEEP (1U << 2)  /* wfi/wfe enter sleep, clocks follow sleep_en */
+
+/* SysTick: 24-bit down counter, one per core */
+#define SYST_CSR (*(volatile uint32_t*)(0xe000e010))  /* Control and status */
+#define SYST_RVR (*(volatile uint32_t*)(0xe000e014))  /* Reload value */
+#define SYST_CVR (*(volatile uint32_t*)(0xe000e018))  /* Current value, any write clears */
+#define SYST_CSR_ENABLE    (1U << 0)
+#define SYST_CSR_TICKINT   (1U << 1)  /* Raise the SysTick exception at zero */
+#define SYST_CSR_CLKSOURCE (1U << 2)  /* Count clk_sys instead of the watchdog tick */
+#define SYST_MAX 0x00ffffffU
+
+/* NVIC (Nested Vectored Interrupt Controller)
+ * Each core has its own NVIC, so these enable interrupts for the calling
+ * core only */
+#if defined(HOST_SIM)
+extern volatile uint32_t simNvic[3];        /* ISER, ICER, ICPR */
+#define NVIC_ISER simNvic[0]
+#define NVIC_ICER simNvic[1]
+#define NVIC_ICPR simNvic[2]
+#else
+#define NVIC_BASE 0xe000e000
+#define NVIC_ISER (*(volatile uint32_t*)(NVIC_BASE + 0x100))
+#define NVIC_ICER (*(volatile uint32_t*)(NVIC_BASE + 0x180))
+#define NVIC_ICPR (*(volatile uint32_t*)(NVIC_BASE + 0x280))
+#endif
+
+/* Code placement
+ * Functions wrapped in __not_in_flash_func are linked into .time_critical,
+ * which resetHandler copies to SRAM, so they run without XIP cache misses
+ * Usage: void __not_in_flash_func(ioIrqBank0)(void) { ... } */
+#if defined(HOST_SIM)
+#define __not_in_flash_func(name) name
+
+/* The harness calls handlers itself and nothing preempts them, the mask
+ * is only tracked so it can check that sections nest */
+extern uint32_t simPrimask;
+
+static inline uint32_t irqDisable(void)
+{
+    uint32_t primask = simPrimask;
+    simPrimask = 1;
+    return primask;
+}
+
+static inline void irqRestore(uint32_t primask)
+{
+    simPrimask = primask;
+}
+
+static inline uint32_t hwDivide(uint32_t dividend, uint32_t divisor)
+{
+    return dividend / divisor;
+}
+#else
+#define __not_in_flash_func(name) \
+    __attribute__((section(".time_critical." #name))) name
+
+/* Interrupt masking around short critical sections */
+static inline uint32_t irqDisable(void)
+{
+    uint32_t primask;
+    __asm volatile("mrs %0, primask\n cpsid i" : "=r"(primask) :: "memory");
+    return primask;
+}
+
+static inline void irqRestore(uint32_t primask)
+{
+    __asm volatile("msr primask, %0" :: "r"(primask) : "memory");
+}
+
+/* Unsigned division on the SIO hardware divider
+ * The Cortex-M0+ has no divide instruction and the firmware links without
+ * libgcc, so runtime division goes through the per-core divider. The
+ * divider state is not saved, so interrupts are masked around it */
+static inline uint32_t hwDivide(uint32_t dividend, uint32_t divisor)
+{
+    uint32_t primask = irqDisable();
+    sio->div_udividend = dividend;
+    sio->div_udivisor = divisor;
+    while ((sio->div_csr & 1U) == 0) {}   /* Ready after 8 cycles */
+    (void)sio->div_remainder;
+    uint32_t quotient = sio->div_quotient;
+    irqRestore(primask);
+    return quotient;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RP2040_H */
@@ -0,0 +1,190 @@
+/* RTC Event Scheduler
+ * Each alarm event makes one pass over the table, like channels.c:
+ * 1. Every schedule with an event at the armed time calls back
+ * 2. Every schedule's next event after now competes for the alarm
+ * 3. The alarm is armed once, for the earliest of them
+ *
+ * The alarm interrupt is a level that stays raised for the whole second
+ * the time matches. So the alarm is disarmed before the callbacks and
+ * only armed again for another second. The one case where that is not
+ * possible is a table with a single daily event. There the next event
+ * is this same second tomorrow, so the alarm takes one empty event a
+ * second later to get past it */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "rtcSchedule.h"
+
+/* Date loaded with the time, only the time of day is used */
+#define RTC_EPOCH_DATE RTC_DATE(2000, 1, 1)
+#define RTC_EPOCH_DOTW (6U << 24)   /* A Saturday */
+
+static const struct rtcSchedule *scheduleTable;
+static uint32_t scheduleCount;
+static rtcScheduleCallback scheduleCallback;
+static uint32_t armedAt;            /* Time of day the alarm matches */
+static bool armed;
+
+/* Seconds from time of day from forward to to */
+static inline uint32_t secondsUntil(uint32_t from, uint32_t to)
+{
+    return to >= from ? to - from : to + RTC_DAY_SECONDS - from;
+}
+
+static inline uint32_t rtcTime(uint32_t timeS)
+{
+    return RTC_TIME(timeS / 3600, (timeS / 60) % 60, timeS % 60);
+}
+
+static uint32_t readTime(void)
+{
+    uint32_t t = rtc->rtc_0;
+    return RTC_HMS(RTC_TIME_HOUR(t), RTC_TIME_MIN(t), RTC_TIME_SEC(t));
+}
+
+/* True if s has an event at time of day t */
+static bool eventAt(const struct rtcSchedule *s, uint32_t t)
+{
+    if (t < s->firstS || t > s->lastS) {
+        return false;
+    }
+    if (s->periodS == 0) {
+        return t == s->firstS;
+    }
+    uint32_t since = t - s->firstS;
+    return since == hwDivide(since, s->periodS) * s->periodS;
+}
+
+/* Seconds from now to the first event of s after it, 1 to a whole day */
+static uint32_t untilNext(const struct rtcSchedule *s, uint32_t now)
+{
+    uint32_t t = s->firstS;
+
+    if (now >= s->firstS && s->periodS != 0) {
+        t += (hwDivide(now - s->firstS, s->periodS) + 1) * s->periodS;
+    }
+    if (t <= now || t > s->lastS) {
+        return s->firstS + RTC_DAY_SECONDS - now;   /* Tomorrow's first */
+    }
+    return t - now;
+}
+
+/* Stop the alarm and drop any interrupt it raised */
+static void disarm(void)
+{
+    rtc->irq_setup_0 = 0;
+    while ((rtc->irq_setup_0 & RTC_IRQ_MATCH_ACTIVE) != 0) {}
+    rtc->intf = 0;
+    NVIC_ICPR = 1U << RTC_IRQ;
+    armed = false;
+}
+
+/* Arm the alarm for the earliest event after now, forced if the RTC
+ * ticked past it while arming */
+static void arm(uint32_t now)
+{
+    uint32_t until = RTC_DAY_SECONDS;
+
+    if (scheduleCount == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < scheduleCount; i++) {
+        uint32_t next = untilNext(&scheduleTable[i], now);
+        if (next < until) {
+            until = next;
+        }
+    }
+    if (until == RTC_DAY_SECONDS) {
+        until = 1;      /* now itself is still matching, see above */
+    }
+
+    uint32_t at = now + until;
+    if (at >= RTC_DAY_SECONDS) {
+        at -= RTC_DAY_SECONDS;
+    }
+    rtc->irq_setup_1 = RTC_IRQ_HOUR_ENA | RTC_IRQ_MIN_ENA | RTC_IRQ_SEC_ENA | rtcTime(at);
+    rtc->irq_setup_0 = RTC_IRQ_MATCH_ENA;
+    while ((rtc->irq_setup_0 & RTC_IRQ_MATCH_ACTIVE) == 0) {}
+    armedAt = at;
+    armed = true;
+
+    if (secondsUntil(now, readTime()) > until) {
+        rtc->intf = RTC_INT_ALARM;
+    }
+}
+
+/* Stop the counters, load timeS and start them again
+ * The counters show the new time a few clk_rtc cycles after it starts */
+static void loadTime(uint32_t timeS)
+{
+    rtc->ctrl = 0;
+    while ((rtc->ctrl & RTC_CTRL_ACTIVE) != 0) {}
+    rtc->setup_0 = RTC_EPOCH_DATE;
+    rtc->setup_1 = RTC_EPOCH_DOTW | rtcTime(timeS);
+    rtc->ctrl = RTC_CTRL_LOAD;
+    rtc->ctrl = RTC_CTRL_ENABLE;
+    while ((rtc->ctrl & RTC_CTRL_ACTIVE) == 0) {}
+    while (secondsUntil(timeS, readTime()) > 1) {}
+}
+
+/* Interrupt handler for the RTC alarm
+ * Overrides the weak alias in startup.c */
+void rtcIrq(void)
+{
+    uint32_t at = armedAt;
+
+    disarm();
+    for (uint32_t i = 0; i < scheduleCount; i++) {
+        if (eventAt(&scheduleTable[i], at)) {
+            scheduleCallback(scheduleTable[i].message);
+        }
+    }
+    arm(readTime());
+}
+
+void rtcScheduleInit(uint32_t timeS)
+{
+    RESETS_RESET &= ~RESET_RTC;
+    while ((RESETS_RESET_DONE & RESET_RTC) == 0) {}
+
+    scheduleCount = 0;
+    armed = false;
+    rtc->clkdiv_m1 = RTC_CLK_HZ - 1;    /* Only while stopped */
+    loadTime(timeS);
+    rtc->inte = RTC_INT_ALARM;
+    NVIC_ISER = 1U << RTC_IRQ;
+}
+
+void rtcScheduleStart(const struct rtcSchedule *table, uint32_t count,
+                      rtcScheduleCallback callback)
+{
+    uint32_t primask = irqDisable();
+
+    disarm();
+    scheduleTable = table;
+    scheduleCount = count;
+    scheduleCallback = callback;
+    arm(readTime());
+    irqRestore(primask);
+}
+
+void rtcScheduleSetTime(uint32_t timeS)
+{
+    uint32_t primask = irqDisable();
+
+    disarm();
+    loadTime(timeS);
+    arm(timeS);
+    irqRestore(primask);
+}
+
+uint32_t rtcScheduleTime(void)
+{
+    return readTime();
+}
+
+bool rtcScheduleNext(uint32_t *timeS)
+{
+    *timeS = armedAt;
+    return armed;
+}
@@ -0,0 +1,72 @@
+/* RTC Event Scheduler
+ * Runs a table of daily schedules on the RTC alarm, for example beacon
+ * transmissions. Times are seconds after midnight on the RTC.
+ *
+ * The alarm is always armed for the earliest next event of the whole
+ * table and matches hour, minute and second only, so an event tomorrow
+ * needs no intermediate wakeup either: between two events the RTC
+ * counts on its own and the core is not woken at all. The RTC runs from
+ * clk_rtc, which must stay enabled in sleep (CLK_EN0_RTC_RTC and
+ * CLK_EN0_SYS_RTC). It stops with the crystal, so DORMANT is no use */
+
+#ifndef RTC_SCHEDULE_H
+#define RTC_SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTC_DAY_SECONDS 86400U
+
+/* Time of day in seconds */
+#define RTC_HMS(hour, min, sec) ((hour) * 3600U + (min) * 60U + (sec))
+
+/* Events at firstS, firstS + periodS and so on up to lastS, every day */
+struct rtcSchedule {
+    uint32_t firstS;        /* First event of the day */
+    uint32_t lastS;         /* No event after this time of day */
+    uint32_t periodS;       /* Between events, 0 for once a day */
+    uint32_t message;       /* Passed to the callback */
+};
+
+/* Every periodS through the day, starting offsetS after midnight */
+#define RTC_SCHEDULE_EVERY(periodS, offsetS, message) \
+    { (offsetS), RTC_DAY_SECONDS - 1, (periodS), (message) }
+
+/* Every periodS from firstS up to lastS */
+#define RTC_SCHEDULE_WINDOW(firstS, lastS, periodS, message) \
+    { (firstS), (lastS), (periodS), (message) }
+
+/* Once a day at timeS */
+#define RTC_SCHEDULE_DAILY(timeS, message) \
+    { (timeS), (timeS), 0, (message) }
+
+/* Called from rtcIrq once for each schedule with an event now */
+typedef void (*rtcScheduleCallback)(uint32_t message);
+
+/* Release the RTC from reset, start it at timeS and enable its
+ * interrupt. Call after clocksInit() */
+void rtcScheduleInit(uint32_t timeS);
+
+/* Run count schedules from table, which must stay valid, and arm the
+ * alarm for the first of their events after now */
+void rtcScheduleStart(const struct rtcSchedule *table, uint32_t count,
+                      rtcScheduleCallback callback);
+
+/* Set the time of day and re-arm for the events after it */
+void rtcScheduleSetTime(uint32_t timeS);
+
+/* Current time of day */
+uint32_t rtcScheduleTime(void);
+
+/* Time of day of the armed event, false if no schedule is running */
+bool rtcScheduleNext(uint32_t *timeS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTC_SCHEDULE_H */
@@ -0,0 +1,156 @@
+/* Morse Symbol Scheduler
+ * Symbols are kept in a lock-free SPSC ring (ring.h) and consumed by the
+ * TIMER alarm 0 interrupt. Each alarm applies the next edge and re-arms the alarm at an
+ * absolute deadline (previous deadline + symbol length), so rounding and
+ * interrupt latency never accumulate over a message */
+
+#include "rp2040.h"
+#include "ring.h"
+#include "scheduler.h"
+#include "instrument.h"
+
+/* Alarm used by the scheduler, one of TIMER alarms 0-3 */
+#define SCHEDULER_ALARM 0
+
+/* Producer: schedulerPush(), consumer: the alarm interrupt */
+RING_DEFINE(symbolQueue, SCHEDULER_QUEUE_SIZE);
+
+static uint32_t keyOutMask;             /* SIO outputs keyed by the scheduler */
+static uint32_t ditLengthUs;            /* Length of one dit unit */
+static uint32_t edgeDeadline;           /* TIMER time of the pending edge */
+static volatile bool running;           /* Alarm chain is active */
+static schedulerSource symbolSource;    /* Consulted when the queue is empty */
+static schedulerKeyHook keyHook;        /* Notified of every edge */
+
+/* Arm the alarm for deadline
+ * The alarm only fires on an exact match with the low timer word, so a
+ * deadline that has already passed is forced instead of waiting a full
+ * 2^32 us wrap */
+static void __not_in_flash_func(armAlarm)(uint32_t deadline)
+{
+    timer->alarm[SCHEDULER_ALARM] = deadline;
+    if ((int32_t)(deadline - timer->timerawl) <= 0) {
+        timer->intf |= 1U << SCHEDULER_ALARM;
+    }
+}
+
+/* Apply the next queued symbol, falling back to the symbol source, and
+ * stop when both are empty
+ * Called from the alarm interrupt, or with interrupts disabled to start */
+static void __not_in_flash_func(advance)(void)
+{
+    uint32_t symbol = 0;
+
+    if (!ringPop(&symbolQueue, &symbol) && symbolSource != 0) {
+        symbol = symbolSource();
+    }
+
+    if (symbol == 0) {
+        sio->gpio_out_clr = keyOutMask; /* Always finish with the key up */
+        instrEdge();
+        if (keyHook != 0) {
+            keyHook(false);
+        }
+        running = false;
+        return;
+    }
+
+    if (symbol & SYMBOL_KEY_DOWN) {
+        sio->gpio_out_set = keyOutMask;
+    } else {
+        sio->gpio_out_clr = keyOutMask;
+    }
+    instrEdge();
+    if (keyHook != 0) {
+        keyHook((symbol & SYMBOL_KEY_DOWN) != 0);
+    }
+
+    edgeDeadline += (symbol & SYMBOL_UNITS_MASK) * ditLengthUs;
+    armAlarm(edgeDeadline);
+}
+
+/* Start a new alarm chain from the current time if none is running
+ * Called with interrupts disabled */
+static void __not_in_flash_func(start)(void)
+{
+    if (!running) {
+        running = true;
+        edgeDeadline = timer->timerawl;
+        advance();
+    }
+}
+
+/* Interrupt handler for TIMER alarm 0
+ * Overrides the weak alias in startup.c, runs from SRAM */
+void __not_in_flash_func(timerIrq0)(void)
+{
+    uint32_t start = instrEnter();
+
+    timer->intf &= ~(1U << SCHEDULER_ALARM);  /* Drop a forced interrupt */
+    timer->intr = 1U << SCHEDULER_ALARM;      /* Clear the alarm interrupt */
+    instrLate(edgeDeadline);
+    advance();
+    instrExit(INSTR_ALARM_EDGE, INSTR_ALARM_ISR, start);
+}
+
+void schedulerInit(uint32_t keyMask, uint32_t ditUs)
+{
+    /* Bring the timer out of reset
+       Its 1 us tick is started by clocksInit() */
+    RESETS_RESET &= ~RESET_TIMER;
+    while ((RESETS_RESET_DONE & RESET_TIMER) == 0) {}
+
+    keyOutMask = keyMask;
+    ditLengthUs = ditUs;
+    symbolQueue.head = 0;
+    symbolQueue.tail = 0;
+    running = false;
+
+    timer->intr = 1U << SCHEDULER_ALARM;
+    timer->inte |= 1U << SCHEDULER_ALARM;
+    NVIC_ISER = 1U << (TIMER_IRQ_0 + SCHEDULER_ALARM);
+}
+
+void schedulerSetDit(uint32_t ditUs)
+{
+    ditLengthUs = ditUs;
+}
+
+bool __not_in_flash_func(schedulerPush)(uint8_t symbol)
+{
+    if (!ringPush(&symbolQueue, symbol)) {
+        return false;
+    }
+
+    /* Only the idle check needs masking: a running chain will pick the
+       symbol up from its own alarm, and masking here means the alarm
+       cannot be halfway through stopping the chain while we look */
+    if (!running) {
+        uint32_t primask = irqDisable();
+        start();
+        irqRestore(primask);
+    }
+    return true;
+}
+
+void schedulerSetSource(schedulerSource source)
+{
+    symbolSource = source;
+}
+
+void schedulerSetKeyHook(schedulerKeyHook hook)
+{
+    keyHook = hook;
+}
+
+void __not_in_flash_func(schedulerStart)(void)
+{
+    uint32_t primask = irqDisable();
+    start();
+    irqRestore(primask);
+}
+
+bool schedulerIdle(void)
+{
+    return !running;
+}
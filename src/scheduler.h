@@ -0,0 +1,68 @@
+/* Morse Symbol Scheduler
+ * Queues key down / key up symbols measured in dit units and plays them
+ * back on TIMER alarm 0. Every on/off edge is produced by the alarm
+ * interrupt, so callers return immediately and the core can sleep in wfi
+ * between edges */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Symbol format
+ * Bit 7 selects key down (1) or key up (0)
+ * Bits 0-6 hold the symbol length in dit units (1-127) */
+#define SYMBOL_KEY_DOWN     0x80
+#define SYMBOL_UNITS_MASK   0x7f
+#define SYMBOL_DOWN(units)  ((uint8_t)(SYMBOL_KEY_DOWN | ((units) & SYMBOL_UNITS_MASK)))
+#define SYMBOL_UP(units)    ((uint8_t)((units) & SYMBOL_UNITS_MASK))
+
+/* Number of symbols the queue can hold, must be a power of two */
+#define SCHEDULER_QUEUE_SIZE 32
+
+/* Symbol source
+ * Called from the alarm interrupt whenever the queue runs dry
+ * Returns the next symbol, or 0 once the source has nothing more to send */
+typedef uint8_t (*schedulerSource)(void);
+
+/* Key hook
+ * Called from the alarm interrupt at every edge with the new key state,
+ * for outputs that are not plain SIO pins (PWM sidetone) */
+typedef void (*schedulerKeyHook)(bool down);
+
+/* Set up TIMER alarm 0 and its interrupt, call after clocksInit()
+ * keyMask: SIO output bits driven high while the key is down
+ * ditUs: length of one dit unit in microseconds */
+void schedulerInit(uint32_t keyMask, uint32_t ditUs);
+
+/* Change the dit length, takes effect from the next queued symbol */
+void schedulerSetDit(uint32_t ditUs);
+
+/* Queue one symbol, starting playback if the scheduler is idle
+ * Lock-free, callable from thread mode or an interrupt handler, but from
+ * only one producer context at a time (see ring.h)
+ * Returns false if the queue is full and the symbol was dropped */
+bool schedulerPush(uint8_t symbol);
+
+/* Attach a symbol source (0 to detach), consulted after the queue */
+void schedulerSetSource(schedulerSource source);
+
+/* Attach a key hook (0 to detach) */
+void schedulerSetKeyHook(schedulerKeyHook hook);
+
+/* Start playback if the scheduler is idle, used after attaching a source */
+void schedulerStart(void);
+
+/* True when nothing is queued and the key is up */
+bool schedulerIdle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULER_H */
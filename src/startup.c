@@ -16,6 +16,25 @@ typedef void (*vectFunc) (void);
  * Used as the initial stack pointer value */
 extern uint32_t _sstack;
 
+/* Initialized data symbols
+ * Defined by the linker script, .data (including .time_critical code)
+ * runs from SRAM at _sdata.._edata and is loaded from flash at _sidata */
+extern uint32_t _sidata;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+
+/* Zero-initialized data symbols
+ * Defined by the linker script, bound the .bss section in SRAM */
+extern uint32_t _sbss;
+extern uint32_t _ebss;
+
+/* Static constructor tables
+ * Defined by the linker script, filled by the C++ compiler */
+extern vectFunc __preinit_array_start[];
+extern vectFunc __preinit_array_end[];
+extern vectFunc __init_array_start[];
+extern vectFunc __init_array_end[];
+
 /* Core handler function declarations
  * These functions handle primary system exceptions
  * defaultHandler and resetHandler are defined in this file */
@@ -67,10 +86,19 @@ void rtcIrq             () __attribute__((weak, alias("defaultHandler")));
  * Defined in a separate source file */
 extern int main(void);
 
+/* Fault recorder, defined in fault.c, runs from SRAM like defaultHandler */
+extern void faultCapture(const uint32_t *frame, uint32_t excReturn) __attribute__((noreturn));
+
+/* SRAM copy of the table below, defined in vector.c (VECTORS=ram) */
+#if defined(VECTOR_TABLE_RAM)
+extern void vectorRelocate(void);
+#endif
+
 /* Vector table definition
  * Placed in .vector section by linker script
  * Contains pointers to exception and interrupt handlers
- * Order matches ARM Cortex-M0+ vector table specification */
+ * Order matches ARM Cortex-M0+ vector table specification
+ * VECTORS=ram builds run from a copy in SRAM, see vector.h */
 const vectFunc vector[] __attribute__((section(".vector"))) = 
 {
     /* Core System Handler Vectors
@@ -130,9 +158,33 @@ const vectFunc vector[] __attribute__((section(".vector"))) =
 
 /* Reset handler implementation
  * Called on system reset, responsible for initializing the system
+ * 1. Copies .data and RAM-resident code from flash to SRAM
+ * 2. Clears .bss so static state starts at zero
+ * 3. Moves VTOR to the SRAM copy of the vector table in VECTORS=ram builds
+ * 4. Runs static constructors for the C++ side
  * Jumps to main() and enters infinite loop if main returns */
 void resetHandler()
 {
+    uint32_t *src = &_sidata;
+    for (uint32_t *dst = &_sdata; dst < &_edata; dst++) {
+        *dst = *src++;
+    }
+
+    for (uint32_t *dst = &_sbss; dst < &_ebss; dst++) {
+        *dst = 0;
+    }
+
+#if defined(VECTOR_TABLE_RAM)
+    vectorRelocate();
+#endif
+
+    for (vectFunc *init = __preinit_array_start; init < __preinit_array_end; init++) {
+        (*init)();
+    }
+    for (vectFunc *init = __init_array_start; init < __init_array_end; init++) {
+        (*init)();
+    }
+
     main(); 
     while(true); /* Infinite loop if main returns */
 }
@@ -145,11 +197,23 @@ void resetHandler()
 #define SIO_GPIO_OUT_XOR              *(volatile uint32_t *) (0xd000001c)
 
 /* Default interrupt handler
- * Called for any unimplemented interrupt
- * Enters low-power wait state until next interrupt */
-void defaultHandler()
+ * Called for any exception or interrupt without a handler of its own,
+ * HardFault and NMI included. Each is a fault: faultCapture() records it
+ * for the next boot and resets through the watchdog
+ * 1. Bit 2 of EXC_RETURN in LR tells which stack the core pushed the
+ *    frame onto, the frame's address goes in r0
+ * 2. EXC_RETURN goes in r1, the frame already holds the caller's LR
+ * 3. mrs leaves the flags of tst alone
+ * In SRAM next to faultCapture(), which keeps that within reach of bl */
+__attribute__((naked, section(".time_critical.defaultHandler"))) void defaultHandler()
 {
-    while (true) {
-        __asm volatile("wfi");  /* Wait for interrupt - low power state */
-    }
-}
\ No newline at end of file
+    __asm volatile(
+        "movs r0, #4\n"
+        "mov r1, lr\n"
+        "tst r0, r1\n"
+        "mrs r0, msp\n"
+        "beq 1f\n"
+        "mrs r0, psp\n"
+        "1:\n"
+        "bl faultCapture\n");
+}
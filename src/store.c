@@ -0,0 +1,326 @@
+/* Flash Settings Store
+ * Sector layout: a 16-byte header, then records packed back to back,
+ * each a 8-byte header and its value padded to 4 bytes. Erased flash
+ * reads 0xff, so a record key of 0xffff marks the end of the log.
+ *
+ * The bootrom programs whole 256-byte pages only. A record is staged in
+ * a page buffer that is 0xff everywhere else: programming a 1 leaves a
+ * bit as it is, so the records already in the page survive.
+ *
+ * Moving to the next sector is ordered so a power cut at any point keeps
+ * the previous sector as the newest valid one:
+ * 1. Erase the next sector
+ * 2. Copy every live record into it, with the value being written in
+ *    place of its key's old one
+ * 3. Program its header last, with a sequence number one higher
+ * A record torn by a power cut fails its check, the scan stops there and
+ * the next write moves on to a fresh sector */
+
+#include "rp2040.h"
+#include "store.h"
+
+#define SECTOR_BYTES  4096U
+#define SECTOR_SHIFT  12
+#define PAGE_BYTES    256U
+#define SECTOR_ERASE_CMD 0x20   /* 4 KB sector erase */
+
+#define STORE_MAGIC   0x53565354U   /* "TSVS" */
+#define KEY_END       0xffffU
+
+struct storeSector {
+    uint32_t magic;
+    uint32_t seq;           /* Higher is newer, wraps */
+    uint32_t seqInv;        /* ~seq, so a torn header never validates */
+    uint32_t reserved;
+};
+
+struct storeRecord {
+    uint16_t key;
+    uint16_t length;
+    uint32_t check;         /* recordCheck of key, length and value */
+};
+
+/* Store region, from rp2040.ld or at the end of the bench's flash image */
+#if defined(HOST_SIM)
+#define storeStart (XIP_FLASH + SIM_FLASH_BYTES - SIM_STORE_BYTES)
+#define storeEnd (XIP_FLASH + SIM_FLASH_BYTES)
+#else
+extern const uint8_t __store_start[];
+extern const uint8_t __store_end[];
+#define storeStart __store_start
+#define storeEnd __store_end
+#endif
+
+/* Bootrom routines, looked up once */
+static romVoidFunc romConnect;
+static romVoidFunc romExitXip;
+static romFlashEraseFunc romErase;
+static romFlashProgramFunc romProgram;
+static romVoidFunc romFlush;
+
+/* boot2, copied to SRAM to set XIP up again after each operation */
+static uint32_t boot2Copy[PAGE_BYTES / 4];
+
+/* Page being staged, 0xff wherever nothing is staged */
+static uint8_t pageBuf[PAGE_BYTES] __attribute__((aligned(4)));
+
+static const struct storeRecord *storeIndex[STORE_KEYS];
+static uint32_t sectorCount;
+static uint32_t activeSector;
+static uint32_t activeSeq;
+static uint32_t writeOffset;        /* In the active sector, SECTOR_BYTES when full */
+
+static inline const uint8_t *sectorBase(uint32_t sector)
+{
+    return storeStart + (sector << SECTOR_SHIFT);
+}
+
+static inline uint32_t recordBytes(uint32_t length)
+{
+    return sizeof(struct storeRecord) + ((length + 3) & ~3U);
+}
+
+/* FNV-1a over key, length and value */
+static uint32_t recordCheck(uint32_t key, const uint8_t *value, uint32_t length)
+{
+    uint32_t hash = 2166136261U ^ (key | (length << 16));
+
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ value[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/* Erase the sector at offset (data NULL) or program count bytes of whole
+ * pages there, offsets counted from the start of flash
+ * 1. Mask interrupts, their vectors and most handlers are in flash
+ * 2. Connect the flash pins to the SSI and leave XIP
+ * 3. Erase or program, then flush the XIP cache of the old contents
+ * 4. Run the copy of boot2, which restores fast XIP and returns */
+static void __not_in_flash_func(flashOp)(uint32_t offset, const uint8_t *data, uint32_t count)
+{
+    uint32_t primask = irqDisable();
+
+    romConnect();
+    romExitXip();
+    if (data == 0) {
+        romErase(offset, SECTOR_BYTES, SECTOR_BYTES, SECTOR_ERASE_CMD);
+    } else {
+        romProgram(offset, data, count);
+    }
+    romFlush();
+#if !defined(HOST_SIM)    /* The bench has no XIP to restore */
+    ((romVoidFunc)((uintptr_t)boot2Copy | 1U))();
+#endif
+
+    irqRestore(primask);
+}
+
+static void pageBufClear(void)
+{
+    for (uint32_t i = 0; i < sizeof pageBuf; i++) {
+        pageBuf[i] = 0xff;
+    }
+}
+
+/* Stage count bytes at *offset of the sector at base, programming each
+ * page as it fills. *offset advances past them */
+static void stageBytes(const uint8_t *base, uint32_t *offset, const uint8_t *src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t at = *offset + i;
+        pageBuf[at & (PAGE_BYTES - 1)] = src[i];
+        if ((at & (PAGE_BYTES - 1)) == PAGE_BYTES - 1) {
+            flashOp((uint32_t)(base - XIP_FLASH) + (at & ~(PAGE_BYTES - 1)),
+                    pageBuf, PAGE_BYTES);
+            pageBufClear();
+        }
+    }
+    *offset += count;
+}
+
+/* Program the page holding the last staged byte, if it is not done yet */
+static void stageFlush(const uint8_t *base, uint32_t offset)
+{
+    if ((offset & (PAGE_BYTES - 1)) != 0) {
+        flashOp((uint32_t)(base - XIP_FLASH) + (offset & ~(PAGE_BYTES - 1)),
+                pageBuf, PAGE_BYTES);
+        pageBufClear();
+    }
+}
+
+/* Stage one record, including its padding */
+static void stageRecord(const uint8_t *base, uint32_t *offset, uint32_t key,
+                        const uint8_t *value, uint32_t length)
+{
+    static const uint8_t padding[3] = { 0xff, 0xff, 0xff };
+    struct storeRecord header;
+
+    header.key = (uint16_t)key;
+    header.length = (uint16_t)length;
+    header.check = recordCheck(key, value, length);
+    stageBytes(base, offset, (const uint8_t *)&header, sizeof header);
+    stageBytes(base, offset, value, length);
+    stageBytes(base, offset, padding, recordBytes(length) - sizeof header - length);
+}
+
+/* Index the records of a sector, returns the offset after the last one
+ * A record that fails its checks ends the scan and the sector counts as
+ * full, the next write must not be merged into a torn one */
+static uint32_t scanSector(uint32_t sector)
+{
+    const uint8_t *base = sectorBase(sector);
+    uint32_t offset = sizeof(struct storeSector);
+
+    for (uint32_t key = 0; key < STORE_KEYS; key++) {
+        storeIndex[key] = 0;
+    }
+    while (offset + sizeof(struct storeRecord) <= SECTOR_BYTES) {
+        const struct storeRecord *record = (const struct storeRecord *)(base + offset);
+        if (record->key == KEY_END) {
+            return offset;
+        }
+        uint32_t bytes = recordBytes(record->length);
+        if (record->key >= STORE_KEYS || record->length > STORE_VALUE_MAX ||
+            offset + bytes > SECTOR_BYTES ||
+            record->check != recordCheck(record->key, (const uint8_t *)(record + 1), record->length)) {
+            return SECTOR_BYTES;
+        }
+        storeIndex[record->key] = record->length != 0 ? record : 0;
+        offset += bytes;
+    }
+    return SECTOR_BYTES;
+}
+
+/* Move on to the next sector with every live record and the new value of
+ * newKey, length 0 leaving it out. Fails without touching flash if they
+ * do not fit */
+static bool nextSector(uint32_t newKey, const uint8_t *value, uint32_t length)
+{
+    uint32_t next = activeSector + 1 == sectorCount ? 0 : activeSector + 1;
+    const uint8_t *base = sectorBase(next);
+    uint32_t used = sizeof(struct storeSector) + (length != 0 ? recordBytes(length) : 0);
+
+    for (uint32_t key = 0; key < STORE_KEYS; key++) {
+        if (storeIndex[key] != 0 && key != newKey) {
+            used += recordBytes(storeIndex[key]->length);
+        }
+    }
+    if (used > SECTOR_BYTES) {
+        return false;
+    }
+
+    flashOp((uint32_t)(base - XIP_FLASH), 0, 0);
+
+    uint32_t offset = sizeof(struct storeSector);
+    for (uint32_t key = 0; key < STORE_KEYS; key++) {
+        const struct storeRecord *record = storeIndex[key];
+        if (record != 0 && key != newKey) {
+            stageRecord(base, &offset, key, (const uint8_t *)(record + 1), record->length);
+        }
+    }
+    if (length != 0) {
+        stageRecord(base, &offset, newKey, value, length);
+    }
+    stageFlush(base, offset);
+
+    struct storeSector header;
+    uint32_t headerOffset = 0;
+    header.magic = STORE_MAGIC;
+    header.seq = activeSeq + 1;
+    header.seqInv = ~header.seq;
+    header.reserved = 0xffffffffU;
+    stageBytes(base, &headerOffset, (const uint8_t *)&header, sizeof header);
+    stageFlush(base, headerOffset);
+
+    activeSector = next;
+    activeSeq = header.seq;
+    writeOffset = scanSector(next);
+    return true;
+}
+
+void storeInit(void)
+{
+    for (uint32_t key = 0; key < STORE_KEYS; key++) {
+        storeIndex[key] = 0;
+    }
+    romConnect = (romVoidFunc)romFuncLookup(ROM_FLASH_CONNECT);
+    romExitXip = (romVoidFunc)romFuncLookup(ROM_FLASH_EXIT_XIP);
+    romErase = (romFlashEraseFunc)romFuncLookup(ROM_FLASH_ERASE);
+    romProgram = (romFlashProgramFunc)romFuncLookup(ROM_FLASH_PROGRAM);
+    romFlush = (romVoidFunc)romFuncLookup(ROM_FLASH_FLUSH);
+
+    const volatile uint32_t *boot2 = (const volatile uint32_t *)XIP_FLASH;
+    for (uint32_t i = 0; i < PAGE_BYTES / 4; i++) {
+        boot2Copy[i] = boot2[i];
+    }
+    pageBufClear();
+
+    /* Newest valid header, one read per sector */
+    bool found = false;
+    sectorCount = (uint32_t)(storeEnd - storeStart) >> SECTOR_SHIFT;
+    for (uint32_t sector = 0; sector < sectorCount; sector++) {
+        const struct storeSector *header = (const struct storeSector *)sectorBase(sector);
+        if (header->magic != STORE_MAGIC || header->seqInv != ~header->seq) {
+            continue;
+        }
+        if (!found || (int32_t)(header->seq - activeSeq) > 0) {
+            activeSector = sector;
+            activeSeq = header->seq;
+            found = true;
+        }
+    }
+
+    if (found) {
+        writeOffset = scanSector(activeSector);
+    } else {
+        /* Empty store, the first write starts sector 0 */
+        activeSector = sectorCount - 1;
+        activeSeq = 0;
+        writeOffset = SECTOR_BYTES;
+    }
+}
+
+const void *storeGet(uint32_t key, uint32_t *length)
+{
+    if (key >= STORE_KEYS || storeIndex[key] == 0) {
+        return 0;
+    }
+    *length = storeIndex[key]->length;
+    return storeIndex[key] + 1;
+}
+
+bool storePut(uint32_t key, const void *value, uint32_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)value;
+
+    if (key >= STORE_KEYS || length > STORE_VALUE_MAX) {
+        return false;
+    }
+
+    /* Spare the flash an identical rewrite */
+    uint32_t storedLength = 0;
+    const uint8_t *stored = (const uint8_t *)storeGet(key, &storedLength);
+    if (stored != 0 ? storedLength == length : length == 0) {
+        uint32_t i = 0;
+        while (i < length && stored[i] == bytes[i]) {
+            i++;
+        }
+        if (i == length) {
+            return true;
+        }
+    }
+
+    if (writeOffset + recordBytes(length) > SECTOR_BYTES) {
+        return nextSector(key, bytes, length);
+    }
+
+    const uint8_t *base = sectorBase(activeSector);
+    uint32_t offset = writeOffset;
+    stageRecord(base, &offset, key, bytes, length);
+    stageFlush(base, offset);
+
+    storeIndex[key] = length != 0 ? (const struct storeRecord *)(base + writeOffset) : 0;
+    writeOffset = offset;
+    return true;
+}
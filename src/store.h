@@ -0,0 +1,58 @@
+/* Flash Settings Store
+ * Small key/value records kept as an append-only log in the store region
+ * at the end of flash (rp2040.ld), so settings survive power cycles and
+ * firmware updates. Values are read in place through XIP, a write
+ * appends a new record for its key.
+ *
+ * The region is a ring of 4 KB erase sectors. Only the newest sector is
+ * written, and when it is full the live records move to the next sector
+ * in the ring, which is erased first. Every sector is erased once per
+ * trip around the ring, and the newest sector on its own always holds
+ * every live value. Boot reads one header per sector to find the newest,
+ * then indexes that sector alone. The work is bounded by the number of
+ * sectors, however many records were ever written.
+ *
+ * Erase and program run from SRAM with interrupts masked and XIP off, and
+ * take tens of milliseconds. Nothing else may use flash meanwhile: no DMA
+ * from .rodata, and core1 must be idle or running from SRAM without
+ * interrupts */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keys, at most STORE_KEYS */
+enum storeKey {
+    STORE_KEY_WPM,          /* uint32_t words per minute */
+    STORE_KEY_TONE_HZ,      /* uint32_t sidetone frequency */
+    STORE_KEY_BEACON,       /* Beacon text of channel k at STORE_KEY_BEACON + k */
+    STORE_KEYS = 16
+};
+
+/* Longest value, so every record fits in two flash pages */
+#define STORE_VALUE_MAX 240
+
+/* Find the newest sector and index its records
+ * Call once at boot, before anything else may disable XIP */
+void storeInit(void);
+
+/* Value of key in flash, 4-byte aligned, or NULL if it was never written
+ * or deleted. The pointer stays valid until the next storePut */
+const void *storeGet(uint32_t key, uint32_t *length);
+
+/* Append a new value for key, length 0 deletes it
+ * A value equal to the stored one is not written again. Returns false if
+ * the key or length is out of range or the live values fill a sector */
+bool storePut(uint32_t key, const void *value, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STORE_H */
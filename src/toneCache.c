@@ -0,0 +1,100 @@
+/* Encoded Message Cache
+ * A miss encodes the text into symbols (morse.h), appends the pause and
+ * converts the symbols into tone words in the replaced entry's buffer.
+ * A hit only compares keys. The DMA reads the entry's buffer in place,
+ * so entries are only replaced while the DMA is idle */
+
+#include "rp2040.h"
+#include "scheduler.h"
+#include "morse.h"
+#include "pioTone.h"
+#include "toneDma.h"
+#include "toneCache.h"
+
+struct toneCacheEntry {
+    uint32_t id;
+    uint32_t pauseUnits;
+    uint32_t generation;    /* pioToneGeneration() when encoded */
+    uint32_t count;         /* 0 for an empty entry */
+    uint32_t lastUse;
+    uint32_t words[TONE_CACHE_WORDS];
+};
+
+static struct toneCacheEntry entries[TONE_CACHE_ENTRIES];
+static uint32_t useClock;
+static uint8_t encodeSymbols[TONE_CACHE_WORDS];
+
+const uint32_t *toneCacheGet(uint32_t id, const char *text, uint32_t pauseUnits,
+                             uint32_t *count)
+{
+    uint32_t generation = pioToneGeneration();
+    struct toneCacheEntry *victim = &entries[0];
+
+    useClock++;
+    for (uint32_t i = 0; i < TONE_CACHE_ENTRIES; i++) {
+        struct toneCacheEntry *entry = &entries[i];
+        if (entry->count != 0 && entry->id == id && entry->pauseUnits == pauseUnits &&
+            entry->generation == generation) {
+            entry->lastUse = useClock;
+            *count = entry->count;
+            return entry->words;
+        }
+        /* Empty entries first, then the least recently used */
+        if (victim->count != 0 &&
+            (entry->count == 0 || (int32_t)(entry->lastUse - victim->lastUse) < 0)) {
+            victim = entry;
+        }
+    }
+
+    /* Miss, a pause longer than one symbol can hold is split */
+    uint32_t symbols = morseEncode(text, encodeSymbols, TONE_CACHE_WORDS);
+    for (uint32_t pause = pauseUnits; pause != 0 && symbols < TONE_CACHE_WORDS; ) {
+        uint32_t units = pause > SYMBOL_UNITS_MASK ? SYMBOL_UNITS_MASK : pause;
+        encodeSymbols[symbols++] = SYMBOL_UP(units);
+        pause -= units;
+    }
+    if (symbols == 0) {
+        return 0;
+    }
+
+    toneDmaBuild(encodeSymbols, symbols, victim->words);
+    victim->id = id;
+    victim->pauseUnits = pauseUnits;
+    victim->generation = generation;
+    victim->count = symbols;
+    victim->lastUse = useClock;
+    *count = symbols;
+    return victim->words;
+}
+
+bool toneCacheSend(uint32_t id, const char *text)
+{
+    uint32_t count;
+
+    if (toneDmaBusy()) {
+        return false;
+    }
+    const uint32_t *words = toneCacheGet(id, text, 0, &count);
+    return words != 0 && toneDmaSend(words, count);
+}
+
+bool toneCacheLoop(uint32_t id, const char *text, uint32_t pauseUnits)
+{
+    uint32_t count;
+
+    if (toneDmaBusy()) {
+        return false;
+    }
+    /* One buffer in both slots repeats it without a gap */
+    const uint32_t *words = toneCacheGet(id, text, pauseUnits, &count);
+    return words != 0 && toneDmaLoop(words, count, words, count);
+}
+
+void toneCacheDrop(uint32_t id)
+{
+    for (uint32_t i = 0; i < TONE_CACHE_ENTRIES; i++) {
+        if (entries[i].id == id) {
+            entries[i].count = 0;
+        }
+    }
+}
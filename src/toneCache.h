@@ -0,0 +1,49 @@
+/* Encoded Message Cache
+ * Keeps the PIO tone words (toneDma.h) of recently sent messages in RAM,
+ * so sending a message again costs one DMA start instead of encoding
+ * its text. Entries are keyed by a message ID chosen by the caller, the
+ * key up pause appended to the message and the pioTone timing
+ * generation, so new speed or tone settings (a new pioToneInit) turn
+ * every older entry into a miss. When the text behind an ID changes,
+ * drop the entry */
+
+#ifndef TONE_CACHE_H
+#define TONE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entries, the least recently used one is replaced on a miss */
+#ifndef TONE_CACHE_ENTRIES
+#define TONE_CACHE_ENTRIES 4
+#endif
+
+/* Longest timeline of an entry in words, pause included */
+#define TONE_CACHE_WORDS 256
+
+/* Timeline of message id, encoded from text followed by pauseUnits of
+ * key up (0 for none) unless a current entry exists. Returns the words
+ * and their count, NULL if the text does not encode into anything
+ * Must not be called while the DMA plays from the cache */
+const uint32_t *toneCacheGet(uint32_t id, const char *text, uint32_t pauseUnits,
+                             uint32_t *count);
+
+/* Send message id once, returns false if the DMA is still busy */
+bool toneCacheSend(uint32_t id, const char *text);
+
+/* Repeat message id and its pause until toneDmaStop(), returns false if
+ * the DMA is still busy */
+bool toneCacheLoop(uint32_t id, const char *text, uint32_t pauseUnits);
+
+/* Forget message id, for example after its text changed */
+void toneCacheDrop(uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TONE_CACHE_H */
@@ -0,0 +1,136 @@
+/* Tone Detector
+ * Goertzel recursion per sample n, with c = 2 cos(w) and w the tone's
+ * angle per sample:
+ *   s[n] = x[n] + c s[n-1] - s[n-2]
+ * After the block the tone's phasor is s1 - s2 cos(w) + j s2 sin(w),
+ * with s1 and s2 the last two values. Its magnitude is approximated by
+ * max + 3/8 min of the parts, within 7 % and without a square root.
+ *
+ * Samples are unsigned around a bias the circuit sets, so each block
+ * subtracts the mean of the block before it (the shift is a division,
+ * TONE_DETECT_BLOCK is a power of two). Whatever bias is left is a
+ * constant, which the filter rejects */
+
+#include "rp2040.h"
+#include "toneDetect.h"
+
+#define COEFF_SHIFT 12          /* Q12 */
+#define BLOCK_SHIFT 6           /* log2(TONE_DETECT_BLOCK) */
+#define PEAK_DECAY_SHIFT 6      /* Peak moves 1/64 towards the floor per block */
+#define FLOOR_SHIFT 4           /* Floor moves 1/16 towards the level per block */
+#define FLOOR_RATIO_SHIFT 1     /* Peak at least 3 times the floor to key */
+#define SETTLE_BLOCKS (2U << FLOOR_SHIFT)   /* Floor found before keying */
+
+typedef char toneDetectBlockShift[(1 << BLOCK_SHIFT) == TONE_DETECT_BLOCK ? 1 : -1];
+
+/* sin(i * pi / 128) in Q15, a quarter wave in 64 steps */
+static const int16_t sineQuarter[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+static int32_t coeff;           /* 2 cos(w), Q12 */
+static int32_t cosW;            /* cos(w), Q12 */
+static int32_t sinW;            /* sin(w), Q12 */
+static int32_t bias;            /* Mean of the previous block */
+static uint32_t level;
+static uint32_t peak;
+static uint32_t floorLevel;
+static uint32_t settling;       /* Blocks left before the first key down */
+static bool keyDown;
+
+/* sin of a 16-bit angle (65536 = 2 pi) in Q15, interpolated */
+static int32_t sine16(uint32_t angle)
+{
+    uint32_t quadrant = (angle >> 14) & 3;
+    uint32_t step = angle & 0x3fff;
+
+    if (quadrant & 1) {
+        step = 0x4000 - step;   /* Falling half of each half wave */
+    }
+    uint32_t i = step >> 8;
+    int32_t value = sineQuarter[i];
+    if (i < 64) {
+        value += ((sineQuarter[i + 1] - sineQuarter[i]) * (int32_t)(step & 0xff)) >> 8;
+    }
+    return quadrant & 2 ? -value : value;
+}
+
+static inline uint32_t magnitude(int32_t re, int32_t im)
+{
+    uint32_t a = (uint32_t)(re < 0 ? -re : re);
+    uint32_t b = (uint32_t)(im < 0 ? -im : im);
+    return a > b ? a + ((3 * b) >> 3) : b + ((3 * a) >> 3);
+}
+
+void toneDetectInit(uint32_t toneHz, uint32_t sampleHz)
+{
+    uint32_t angle = hwDivide(toneHz << 16, sampleHz);
+
+    sinW = sine16(angle) >> (15 - COEFF_SHIFT);
+    cosW = sine16(angle + 0x4000) >> (15 - COEFF_SHIFT);
+    coeff = 2 * cosW;
+    bias = 128;
+    level = 0;
+    peak = 0;
+    floorLevel = 0;
+    settling = SETTLE_BLOCKS;
+    keyDown = false;
+}
+
+bool __not_in_flash_func(toneDetectBlock)(const uint8_t *samples)
+{
+    int32_t s1 = 0;
+    int32_t s2 = 0;
+    int32_t sum = 0;
+
+    for (uint32_t n = 0; n < TONE_DETECT_BLOCK; n++) {
+        int32_t x = samples[n];
+        int32_t s = x - bias + ((coeff * s1) >> COEFF_SHIFT) - s2;
+        s2 = s1;
+        s1 = s;
+        sum += x;
+    }
+    bias = sum >> BLOCK_SHIFT;
+
+    level = magnitude(s1 - ((s2 * cosW) >> COEFF_SHIFT), (s2 * sinW) >> COEFF_SHIFT);
+
+    if (level > peak) {
+        peak = level;
+    } else if (!keyDown) {
+        peak -= (peak - floorLevel) >> PEAK_DECAY_SHIFT;
+    }
+    if (!keyDown) {
+        if (level > floorLevel) {
+            floorLevel += (level - floorLevel) >> FLOOR_SHIFT;
+        } else {
+            floorLevel -= (floorLevel - level) >> FLOOR_SHIFT;
+        }
+    }
+
+    uint32_t span = peak - floorLevel;
+    if (settling != 0) {
+        settling--;
+        peak = floorLevel;
+        keyDown = false;
+    } else if (span < TONE_DETECT_SQUELCH || span < (floorLevel << FLOOR_RATIO_SHIFT)) {
+        keyDown = false;
+    } else if (keyDown) {
+        keyDown = level > floorLevel + ((3 * span) >> 3);
+    } else {
+        keyDown = level > floorLevel + ((5 * span) >> 3);
+    }
+    return keyDown;
+}
+
+uint32_t toneDetectLevel(void)
+{
+    return level;
+}
@@ -0,0 +1,57 @@
+/* Tone Detector
+ * Turns blocks of 8-bit audio samples into a key state, for decoding
+ * Morse received as audio. Hardware independent: audioRx.h feeds it
+ * from the ADC, the host benchmark from synthesized audio.
+ *
+ * Each block runs one Goertzel filter at the tone in Q12 fixed point,
+ * one multiply per sample and no division. The block's tone level is
+ * compared against a peak and a noise floor that follow the signal, so
+ * no gain setting is needed:
+ * 1. The key goes down above 5/8 and up below 3/8 of the way from
+ *    floor to peak, the gap between the two is the hysteresis
+ * 2. While the key is up the floor averages the level and the peak
+ *    decays towards it, while it is down both hold
+ * 3. Unless the peak stands TONE_DETECT_SQUELCH above the floor and is
+ *    three times as high, the key stays up, so band noise alone does
+ *    not key. The first 32 blocks after toneDetectInit() only find the
+ *    floor
+ *
+ * A block is the time resolution of the key edges: 64 samples are 8 ms
+ * at 8 kS/s and 4 ms at 16 kS/s, against a 60 ms dit at 20 WPM */
+
+#ifndef TONE_DETECT_H
+#define TONE_DETECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Samples per block. 8-bit samples, 64-sample blocks and Q12
+ * coefficients keep every product within 32 bits down to a tone of
+ * sampleHz / 80 */
+#define TONE_DETECT_BLOCK 64
+
+/* Least difference between peak and floor that can key, in tone level
+ * units. A full scale tone on the filter frequency reads 4096 */
+#ifndef TONE_DETECT_SQUELCH
+#define TONE_DETECT_SQUELCH 96
+#endif
+
+/* Set the filter to toneHz at sampleHz and forget the levels seen */
+void toneDetectInit(uint32_t toneHz, uint32_t sampleHz);
+
+/* Run one block of TONE_DETECT_BLOCK samples (0-255, silence at the
+ * mid-point), returns the key state after it */
+bool toneDetectBlock(const uint8_t *samples);
+
+/* Tone level of the last block */
+uint32_t toneDetectLevel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TONE_DETECT_H */
@@ -0,0 +1,145 @@
+/* DMA Symbol Stream
+ * One-shot mode uses channel A alone. Loop mode chains A -> B -> A; a
+ * channel that finishes keeps its end read address, so dmaIrq0 writes the
+ * start address and count back through the non-triggering aliases and
+ * the chain trigger from the other channel restarts it */
+
+#include "rp2040.h"
+#include "pioTone.h"
+#include "toneDma.h"
+
+/* Channel control shared by both channels, chain target added per use */
+#define TONE_DMA_CTRL (DMA_CTRL_EN | DMA_CTRL_DATA_SIZE_WORD | DMA_CTRL_INCR_READ | \
+                       DMA_CTRL_TREQ_SEL(DREQ_PIO0_TX0))
+
+#define CH_MASK(ch) (1U << (ch))
+
+static const uint32_t *volatile slotWords[2];  /* Buffers for A and B */
+static volatile uint32_t slotCount[2];
+static volatile bool looping;
+static volatile bool busy;
+static toneDmaCallback doneCallback;
+
+void toneDmaInit(void)
+{
+    RESETS_RESET &= ~RESET_DMA;
+    while ((RESETS_RESET_DONE & RESET_DMA) == 0) {}
+
+    dma->ints0 = CH_MASK(TONE_DMA_CH_A) | CH_MASK(TONE_DMA_CH_B);
+    dma->inte0 |= CH_MASK(TONE_DMA_CH_A) | CH_MASK(TONE_DMA_CH_B);
+    NVIC_ISER = 1U << DMA_IRQ_0;
+}
+
+void toneDmaBuild(const uint8_t *symbols, uint32_t count, uint32_t *words)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        words[i] = pioToneWord(symbols[i]);
+    }
+}
+
+/* Program a channel without starting it */
+static void channelSetup(uint32_t ch, uint32_t chainTo,
+                         const uint32_t *words, uint32_t count)
+{
+    volatile struct dma_channel_hw *c = &dma->ch[ch];
+    c->read_addr = (uint32_t)words;
+    c->write_addr = (uint32_t)&pio0->txf[0];
+    c->transfer_count = count;
+    c->al1_ctrl = TONE_DMA_CTRL | DMA_CTRL_CHAIN_TO(chainTo);
+}
+
+bool toneDmaSend(const uint32_t *words, uint32_t count)
+{
+    if (busy) {
+        return false;
+    }
+    busy = true;
+    looping = false;
+
+    /* Chaining a channel to itself disables chaining */
+    channelSetup(TONE_DMA_CH_A, TONE_DMA_CH_A, words, count);
+    dma->multi_chan_trigger = CH_MASK(TONE_DMA_CH_A);
+    return true;
+}
+
+bool toneDmaLoop(const uint32_t *wordsA, uint32_t countA,
+                 const uint32_t *wordsB, uint32_t countB)
+{
+    if (busy) {
+        return false;
+    }
+    busy = true;
+    looping = true;
+
+    slotWords[0] = wordsA;
+    slotCount[0] = countA;
+    slotWords[1] = wordsB;
+    slotCount[1] = countB;
+
+    channelSetup(TONE_DMA_CH_A, TONE_DMA_CH_B, wordsA, countA);
+    channelSetup(TONE_DMA_CH_B, TONE_DMA_CH_A, wordsB, countB);
+    dma->multi_chan_trigger = CH_MASK(TONE_DMA_CH_A);
+    return true;
+}
+
+void toneDmaSetBuffer(uint32_t slot, const uint32_t *words, uint32_t count)
+{
+    uint32_t primask = irqDisable();
+    slotWords[slot] = words;
+    slotCount[slot] = count;
+    irqRestore(primask);
+}
+
+void toneDmaStop(void)
+{
+    uint32_t primask = irqDisable();
+    looping = false;
+
+    /* Break the chain first so an abort cannot trigger the partner */
+    dma->ch[TONE_DMA_CH_A].al1_ctrl = TONE_DMA_CTRL | DMA_CTRL_CHAIN_TO(TONE_DMA_CH_A);
+    dma->ch[TONE_DMA_CH_B].al1_ctrl = TONE_DMA_CTRL | DMA_CTRL_CHAIN_TO(TONE_DMA_CH_B);
+    dma->chan_abort = CH_MASK(TONE_DMA_CH_A) | CH_MASK(TONE_DMA_CH_B);
+    while (dma->chan_abort != 0) {}
+
+    dma->ints0 = CH_MASK(TONE_DMA_CH_A) | CH_MASK(TONE_DMA_CH_B);
+    busy = false;
+    irqRestore(primask);
+}
+
+void toneDmaSetCallback(toneDmaCallback callback)
+{
+    doneCallback = callback;
+}
+
+bool __not_in_flash_func(toneDmaBusy)(void)
+{
+    return busy;
+}
+
+/* Interrupt handler for DMA IRQ 0
+ * Overrides the weak alias in startup.c. Runs once per buffer, never per
+ * symbol */
+void __not_in_flash_func(dmaIrq0)(void)
+{
+    uint32_t status = dma->ints0 & (CH_MASK(TONE_DMA_CH_A) | CH_MASK(TONE_DMA_CH_B));
+    dma->ints0 = status;
+
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        uint32_t ch = slot == 0 ? TONE_DMA_CH_A : TONE_DMA_CH_B;
+        if ((status & CH_MASK(ch)) == 0) {
+            continue;
+        }
+
+        if (looping) {
+            /* Re-arm without triggering, the partner's chain restarts us */
+            dma->ch[ch].read_addr = (uint32_t)slotWords[slot];
+            dma->ch[ch].transfer_count = slotCount[slot];
+        } else {
+            busy = false;
+        }
+
+        if (doneCallback != 0) {
+            doneCallback(slot);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/* DMA Symbol Stream
+ * Transmits a whole message by pointing a DMA channel at a buffer of PIO
+ * tone words (see pioTone.h). Transfers are paced by the PIO0 TX DREQ,
+ * so the CPU cost of a message does not depend on its length, and
+ * dmaIrq0 only fires when a buffer has been consumed */
+
+#ifndef TONE_DMA_H
+#define TONE_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DMA channels used, the pair is chained for loop mode */
+#define TONE_DMA_CH_A 0
+#define TONE_DMA_CH_B 1
+
+/* Called from dmaIrq0 when a one-shot message completes or, in loop
+ * mode, each time a buffer has been consumed (slot 0 = A, 1 = B) */
+typedef void (*toneDmaCallback)(uint32_t slot);
+
+/* Release the DMA block from reset and enable its interrupt
+ * Call after pioToneInit() */
+void toneDmaInit(void);
+
+/* Convert count scheduler symbols into PIO tone words
+ * words must have room for count entries */
+void toneDmaBuild(const uint8_t *symbols, uint32_t count, uint32_t *words);
+
+/* Send count words once, returns false if a transfer is still running
+ * words must stay valid until the callback reports completion */
+bool toneDmaSend(const uint32_t *words, uint32_t count);
+
+/* Continuous beacon mode
+ * Two channels chained to each other play buffer A then buffer B for ever.
+ * When a buffer finishes, dmaIrq0 re-arms its channel while the other one
+ * runs, so there is no gap. Pass the same buffer twice to repeat one
+ * message */
+bool toneDmaLoop(const uint32_t *wordsA, uint32_t countA,
+                 const uint32_t *wordsB, uint32_t countB);
+
+/* Replace a loop buffer, takes effect the next time that slot is re-armed
+ * Double buffering: refill the slot the callback just reported */
+void toneDmaSetBuffer(uint32_t slot, const uint32_t *words, uint32_t count);
+
+/* Abort any transfer, the PIO finishes the words already in its FIFO */
+void toneDmaStop(void);
+
+/* Completion callback, 0 for none */
+void toneDmaSetCallback(toneDmaCallback callback);
+
+/* True while a one-shot transfer or loop is running */
+bool toneDmaBusy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TONE_DMA_H */
@@ -0,0 +1,990 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "scheduler.h"
+#include "morse.h"
+#include "pioTone.h"
+#include "toneDma.h"
+#include "toneCache.h"
+#include "pwmTone.h"
+#include "multicore.h"
+#include "decoder.h"
+#include "debounce.h"
+#include "iambic.h"
+#include "uartRx.h"
+#include "usbCdc.h"
+#include "command.h"
+#include "power.h"
+#include "channels.h"
+#include "instrument.h"
+#include "pin.h"
+#include "board.h"
+#include "regInit.h"
+#include "store.h"
+#include "rtcSchedule.h"
+#include "audioRx.h"
+#include "fault.h"
+
+/* Pins of the board profile, selected with BOARD= in the Makefile */
+typedef Pin<BUTTON_PIN> buttonPin;
+typedef Pin<LED_PIN> ledPin;
+typedef Pin<SPEAKER_PIN> speakerPin;
+typedef PinGroup<LED_PIN, SPEAKER_PIN> keyPins;    /* Keyed together by the TIMER keyer */
+
+/* Clock profile, override with -DCLOCK_PROFILE=CLOCK_PROFILE_XOSC for
+   battery builds */
+#ifndef CLOCK_PROFILE
+#define CLOCK_PROFILE CLOCK_PROFILE_125MHZ
+#endif
+
+/* Keying configuration */
+#define WPM 20          /* Sending speed in words per minute */
+#define BEEP_UNITS 3    /* Key down length queued per button press */
+#define STARTUP_MESSAGE "EEE"   /* Startup test pattern, three short beeps */
+#define TONE_HZ 700     /* Sidetone frequency for the PIO and PWM keyers */
+
+#define MESSAGE_MAX_SYMBOLS 256 /* Longest message sent in one DMA transfer */
+
+/* Settings kept in the flash store (store.h) replace WPM, TONE_HZ and
+ * the beacon texts at boot. Values outside these ranges are ignored */
+#define WPM_MIN 5
+#define WPM_MAX 60
+#define TONE_HZ_MIN 200
+#define TONE_HZ_MAX 2000
+#define BEACON_TEXT_MAX 40
+
+static uint32_t keyerWpm = WPM;
+static uint32_t keyerToneHz = TONE_HZ;
+
+/* Button handling, selected with BUTTON_MODE= in the Makefile
+ * BUTTON_STRAIGHT_KEY: the button is a straight key. Both edges are
+ *            timestamped into the decoder, which turns them into text,
+ *            and the sidetone follows the key directly
+ * BUTTON_IAMBIC: additionally runs an iambic keyer on the paddle pins,
+ *            the button still beeps
+ * default:   every press queues a fixed BEEP_UNITS beep */
+#ifndef BUTTON_DEBOUNCE_US
+#define BUTTON_DEBOUNCE_US DEBOUNCE_MECHANICAL_US   /* Lockout after each edge */
+#endif
+#ifndef PADDLE_DEBOUNCE_US
+#define PADDLE_DEBOUNCE_US DEBOUNCE_MECHANICAL_US
+#endif
+#ifndef IAMBIC_MODE
+#define IAMBIC_MODE IAMBIC_MODE_B
+#endif
+
+#if defined(BUTTON_IAMBIC) && (defined(KEYER_PIO) || defined(KEYER_CORE1))
+#error "The iambic keyer needs the TIMER scheduler on core0 (KEYER=timer or pwm)"
+#endif
+
+/* Serial input, enabled with UART=1 in the Makefile
+ * Text received on UART0 is keyed as it arrives. The encoder becomes the
+ * scheduler source, so it cannot be combined with the iambic keyer.
+ * With KEYER=pio the port takes setting commands only and keys nothing */
+#ifndef UART_BAUD
+#define UART_BAUD 115200
+#endif
+#ifndef UART_FLOW
+#define UART_FLOW UART_FLOW_XONXOFF
+#endif
+
+#if defined(UART_INPUT) && (defined(KEYER_CORE1) || defined(BUTTON_IAMBIC))
+#error "UART input needs the TIMER scheduler on core0 or KEYER=pio, and no iambic keyer"
+#endif
+
+/* USB serial port, enabled with USB=1 in the Makefile
+ * Text from the host is keyed as it arrives, decoded straight-key text
+ * goes back to the host and an ENQ byte asks for a status line */
+#if defined(USB_CDC) && (defined(KEYER_PIO) || defined(KEYER_CORE1) || \
+                         defined(BUTTON_IAMBIC) || defined(UART_INPUT))
+#error "USB input needs the TIMER scheduler on core0, no iambic keyer and no UART input"
+#endif
+
+/* Setting commands from the host (command.h), written to the flash store
+ * and put in effect at once. USB answers each with OK or ERR */
+#if defined(UART_INPUT) || defined(USB_CDC)
+#define HOST_COMMANDS
+#endif
+
+/* Audio receive, enabled with AUDIO_RX=1 in the Makefile
+ * Receiver audio on the board's AUDIO_PIN is decoded as Morse at the
+ * sidetone pitch, through the same decoder a straight key feeds. The
+ * decoded text goes wherever straight-key text goes */
+#ifndef AUDIO_SAMPLE_HZ
+#define AUDIO_SAMPLE_HZ 8000
+#endif
+
+#if defined(AUDIO_RX) && defined(BUTTON_STRAIGHT_KEY)
+#error "AUDIO_RX and BUTTON_MODE=straight both feed the decoder, choose one"
+#endif
+#if defined(AUDIO_RX) && defined(UART_INPUT)
+#error "AUDIO_RX and UART input share DMA_IRQ_1"
+#endif
+/* audioRxInit() fails without clk_adc, which the crystal profile stops.
+ * board.h already rejects an AUDIO_PIN without an ADC input, so with
+ * this the call cannot fail */
+#if defined(AUDIO_RX)
+static_assert(CLOCK_PROFILE != CLOCK_PROFILE_XOSC, "AUDIO_RX needs clk_adc, which CLOCK_PROFILE_XOSC stops");
+#endif
+#if defined(BUTTON_STRAIGHT_KEY) || defined(AUDIO_RX)
+#define DECODER_INPUT   /* Key edges go to the decoder */
+#endif
+
+/* Beacon channels, enabled with CHANNELS=n in the Makefile
+ * Channel k keys GPIO BEACON_FIRST_PIN + k with its own repeating
+ * beacon, next to whatever the main keyer does. All channels start
+ * together on TIMER alarm 3 and stay in step. The board profile sets the
+ * first pin and how many are free (board.h checks the count) */
+#if defined(BEACON_CHANNELS)
+#define BEACON_MAX_SYMBOLS 64
+static_assert(STORE_KEY_BEACON + BEACON_CHANNELS <= STORE_KEYS, "no store key for every beacon");
+#endif
+
+/* PIO beacon, enabled with PIO_BEACON=1 in the Makefile (KEYER=pio)
+ * A button press starts or stops channel 0's beacon text on the PIO
+ * sidetone, repeated by the DMA loop from the message cache */
+#if defined(PIO_BEACON) && !defined(KEYER_PIO)
+#error "PIO_BEACON needs KEYER=pio"
+#endif
+#if defined(PIO_BEACON) && (defined(BUTTON_STRAIGHT_KEY) || defined(BUTTON_IAMBIC))
+#error "PIO_BEACON uses the button, BUTTON_MODE=beep only"
+#endif
+
+/* RTC beacon, enabled with RTC_BEACON=1 in the Makefile (KEYER=pio)
+ * The RTC alarm wakes the core for the scheduled transmissions only, and
+ * for the watchdog keepalive below unless WATCHDOG=0.
+ * Each one sends its beacon text once through the message cache and the
+ * DMA, the core sleeps until the next one. The RTC loses its time with
+ * the power and starts from BEACON_CLOCK_START, the time of day at
+ * power up */
+#if defined(RTC_BEACON) && !defined(KEYER_PIO)
+#error "RTC_BEACON needs KEYER=pio"
+#endif
+#ifndef BEACON_CLOCK_START
+#define BEACON_CLOCK_START RTC_HMS(0, 0, 0)
+#endif
+
+/* Watchdog, enabled with WATCHDOG=1 in the Makefile
+ * It runs while the core is awake, so an interrupt handler that never
+ * returns, or a main loop that never gets back to sleep, resets the
+ * unit. The main loop pauses it around the sleep with interrupts
+ * masked and restarts it before the waking interrupt is taken, so a
+ * sleep of any length needs no wake up of its own to feed it */
+#ifndef WATCHDOG_TIMEOUT_MS
+#define WATCHDOG_TIMEOUT_MS 8000
+#endif
+
+#if defined(RTC_BEACON)
+/* Message k of a schedule sends beacon text k */
+static const struct rtcSchedule wakeSchedule[] = {
+    RTC_SCHEDULE_EVERY(RTC_HMS(0, 10, 0), 0, 0),    /* Text A every 10 minutes */
+    RTC_SCHEDULE_DAILY(RTC_HMS(12, 5, 0), 1),       /* Text B at 12:05 */
+};
+#endif
+
+#if defined(BEACON_CHANNELS) || defined(PIO_BEACON) || defined(RTC_BEACON)
+#define BEACON_PAUSE_UNITS 70   /* Key up between repeats */
+#define BEACON_DEFAULT_TEXT "VVV DE BCN?"   /* ? becomes the channel letter */
+#endif
+
+/* Messages of the PIO keyer's cache (toneCache.h), beacon text k is
+ * MESSAGE_BEACON + k */
+enum messageId {
+    MESSAGE_STARTUP,
+    MESSAGE_BEACON
+};
+
+/* Idle power, selected with POWER= in the Makefile
+ * POWER_SLEEP:   clocks of unused blocks are gated while the core sleeps
+ * POWER_DORMANT: additionally stops the crystal while nothing is queued,
+ *                until the button is pressed. Needs the TIMER scheduler on
+ *                core0 and no other input than the button */
+#if defined(POWER_DORMANT) && (defined(KEYER_PIO) || defined(KEYER_CORE1) || \
+                               defined(BUTTON_IAMBIC) || defined(UART_INPUT) || defined(USB_CDC) || \
+                               defined(BEACON_CHANNELS) || defined(AUDIO_RX))
+#error "DORMANT only wakes on the button, use POWER=sleep with this configuration"
+#endif
+
+/* Blocks that keep working while the core sleeps */
+#if defined(KEYER_PIO)
+#define SLEEP_KEYER_EN0 (CLK_EN0_SYS_PIO0 | CLK_EN0_SYS_DMA)
+#elif defined(KEYER_PWM)
+#define SLEEP_KEYER_EN0 CLK_EN0_SYS_PWM
+#else
+#define SLEEP_KEYER_EN0 0
+#endif
+#if defined(UART_INPUT)
+#define SLEEP_INPUT_EN0 CLK_EN0_SYS_DMA
+#define SLEEP_INPUT_EN1 (CLK_EN1_PERI_UART0 | CLK_EN1_SYS_UART0)
+#elif defined(USB_CDC)
+#define SLEEP_INPUT_EN0 0
+#define SLEEP_INPUT_EN1 (CLK_EN1_SYS_USBCTRL | CLK_EN1_USB_USBCTRL)
+#else
+#define SLEEP_INPUT_EN0 0
+#define SLEEP_INPUT_EN1 0
+#endif
+#if defined(RTC_BEACON)
+#define SLEEP_RTC_EN0 (CLK_EN0_RTC_RTC | CLK_EN0_SYS_RTC)
+#else
+#define SLEEP_RTC_EN0 0
+#endif
+#if defined(AUDIO_RX)
+#define SLEEP_AUDIO_EN0 (CLK_EN0_ADC_ADC | CLK_EN0_SYS_ADC | CLK_EN0_SYS_DMA)
+#else
+#define SLEEP_AUDIO_EN0 0
+#endif
+
+/* Blocks released from reset together at startup, before any driver
+ * runs. The drivers still release their own blocks, which then costs
+ * one check of RESET_DONE. PIO0 and USB are reset by their drivers */
+#if defined(KEYER_PIO)
+#define INIT_KEYER_RESETS RESET_DMA
+#elif defined(KEYER_PWM)
+#define INIT_KEYER_RESETS RESET_PWM
+#else
+#define INIT_KEYER_RESETS 0
+#endif
+#if defined(UART_INPUT)
+#define INIT_INPUT_RESETS (RESET_UART0 | RESET_DMA)
+#else
+#define INIT_INPUT_RESETS 0
+#endif
+#define INIT_RESETS (RESET_IO_BANK0 | RESET_PADS_BANK0 | RESET_TIMER | \
+                     INIT_KEYER_RESETS | INIT_INPUT_RESETS)
+
+/* SIO outputs driven by this build: the LED, the speaker unless a tone
+ * peripheral owns it, and the beacon pins */
+#if defined(KEYER_PIO) || defined(KEYER_PWM)
+#define INIT_SPEAKER_MASK 0U
+#else
+#define INIT_SPEAKER_MASK speakerPin::mask
+#endif
+#if defined(BEACON_CHANNELS)
+#define INIT_BEACON_MASK BOARD_BEACON_MASK
+#define INIT_BEACON_PINS BEACON_CHANNELS
+#else
+#define INIT_BEACON_MASK 0U
+#define INIT_BEACON_PINS 0
+#endif
+#define INIT_OUTPUT_MASK (ledPin::mask | INIT_SPEAKER_MASK | INIT_BEACON_MASK)
+
+/* Pin setup of the board as one table in .rodata, built at compile time:
+ * 1. Function select for every SIO pin, the button's pad
+ * 2. All outputs low with one gpio_out_clr store
+ * 3. All output enables with one gpio_oe_set store, the button's cleared
+ * Pins of the paddle, UART and tone drivers are set up by those drivers */
+#define PIN_INIT_MAX (7 + INIT_BEACON_PINS)
+
+struct pinInitTable {
+    struct regInit entry[PIN_INIT_MAX];
+    uint32_t count;
+};
+
+static constexpr pinInitTable makePinInit() {
+    pinInitTable table{};
+    uint32_t n = 0;
+
+    table.entry[n++] = { REG_INIT_GPIO_CTRL(BUTTON_PIN), REG_INIT_ALL, GPIO_FUNC_SIO };
+    table.entry[n++] = { REG_INIT_PAD(BUTTON_PIN), REG_INIT_ALL, BUTTON_PAD };
+    table.entry[n++] = { REG_INIT_GPIO_CTRL(LED_PIN), REG_INIT_ALL, GPIO_FUNC_SIO };
+    if (INIT_SPEAKER_MASK != 0) {
+        table.entry[n++] = { REG_INIT_GPIO_CTRL(SPEAKER_PIN), REG_INIT_ALL, GPIO_FUNC_SIO };
+    }
+#if defined(BEACON_CHANNELS)
+    for (uint32_t k = 0; k < BEACON_CHANNELS; k++) {
+        table.entry[n++] = { REG_INIT_GPIO_CTRL(BEACON_FIRST_PIN + k), REG_INIT_ALL, GPIO_FUNC_SIO };
+    }
+#endif
+    table.entry[n++] = { REG_INIT_SIO(gpio_oe_clr), REG_INIT_ALL, buttonPin::mask };
+    table.entry[n++] = { REG_INIT_SIO(gpio_out_clr), REG_INIT_ALL, INIT_OUTPUT_MASK };
+    table.entry[n++] = { REG_INIT_SIO(gpio_oe_set), REG_INIT_ALL, INIT_OUTPUT_MASK };
+    table.count = n;
+    return table;
+}
+
+static constexpr pinInitTable pinInit = makePinInit();
+
+/* These replace the scheduler source, fixed text is queued instead */
+#if defined(BUTTON_IAMBIC) || defined(UART_INPUT) || defined(USB_CDC)
+#define KEYER_QUEUE_TEXT
+#endif
+
+/* Keying engine, selected with KEYER= in the Makefile
+ * KEYER_PIO: PIO0 generates a real sidetone on the speaker, the LED is
+ *            not keyed. Messages are encoded up front and sent by DMA
+ * KEYER_PWM: the TIMER scheduler keys the LED and ramps a PWM sidetone
+ *            on the speaker, leaving PIO free
+ * default:   the TIMER scheduler keys LED and speaker together as plain
+ *            SIO outputs
+ * KEYER_CORE1 (with the default engine): the scheduler runs on core1 and
+ *            core0 only hands symbols and text over */
+#if defined(KEYER_QUEUE_TEXT)
+static uint8_t messageSymbols[MESSAGE_MAX_SYMBOLS];
+#endif
+
+/* Queue one symbol, false if it was dropped
+ * The PIO keyer's tone DMA feeds the same TX FIFO, so symbols are dropped
+ * while it runs instead of landing between the words of its message */
+static inline bool keyerPush(uint8_t symbol) {
+#if defined(KEYER_PIO)
+    return !toneDmaBusy() && pioTonePush(symbol);
+#elif defined(KEYER_CORE1)
+    return keyerCorePush(symbol);
+#else
+    return schedulerPush(symbol);
+#endif
+}
+
+/* Send text, the PIO keyer caches its encoding under id
+ * Returns false if the text was cut short or not sent at all */
+static inline bool keyerSend(uint32_t id, const char *text) {
+#if defined(KEYER_PIO)
+    return toneCacheSend(id, text);
+#elif defined(KEYER_CORE1)
+    (void)id;
+    keyerCoreSend(text);
+    return true;
+#elif defined(KEYER_QUEUE_TEXT)
+    /* The paddles, the UART or USB own the scheduler source, queue the
+       text instead. The queue holds the encoded text as far as it fits,
+       up to the last whole character; the first encoding only counts
+       the symbols that did not. buttonEdge() pushes from ioIrqBank0,
+       so interrupts stay masked while pushing and the queue keeps one
+       producer at a time */
+    (void)id;
+    uint32_t total = morseEncode(text, messageSymbols, MESSAGE_MAX_SYMBOLS);
+    uint32_t count = morseEncode(text, messageSymbols, SCHEDULER_QUEUE_SIZE);
+    bool whole = count == total;
+    uint32_t primask = irqDisable();
+    for (uint32_t i = 0; i < count; i++) {
+        whole = schedulerPush(messageSymbols[i]) && whole;
+    }
+    irqRestore(primask);
+    return whole;
+#else
+    (void)id;
+    morseSend(text);
+    return true;
+#endif
+}
+
+/* Follow a straight key with the sidetone
+ * The PIO keyer owns the speaker, so only the LED follows there. Either
+ * way the pins move with one constant store */
+static inline void sidetoneKey(bool down) {
+#if defined(KEYER_PIO)
+    ledPin::write(down);
+#elif defined(KEYER_PWM)
+    pwmToneKey(down);
+    ledPin::write(down);
+#else
+    keyPins::write(down);
+#endif
+    instrEdge();
+}
+
+#if defined(BUTTON_STRAIGHT_KEY)
+/* Debounced straight key edge
+ * Only records the edge, decoding happens in decoderPoll() from the main
+ * loop */
+static void __not_in_flash_func(buttonEdge)(uint32_t timestampUs, bool down) {
+    decoderEdge(timestampUs, down);
+    sidetoneKey(down);
+}
+#elif defined(PIO_BEACON)
+static volatile bool beaconToggle;
+
+/* Debounced button edge, the main loop starts or stops the beacon */
+static void __not_in_flash_func(buttonEdge)(uint32_t timestampUs, bool down) {
+    (void)timestampUs;
+    if (down) {
+        beaconToggle = true;
+    }
+}
+#else
+/* Debounced button edge */
+static void __not_in_flash_func(buttonEdge)(uint32_t timestampUs, bool down) {
+    (void)timestampUs;
+    if (down) {
+        /* Queue the beep and return at once:
+           1. Key down for BEEP_UNITS dits (LED and speaker on)
+           2. Key up for one dit so back-to-back presses stay separate
+           3. The scheduler's alarm interrupt produces both edges */
+        keyerPush(SYMBOL_DOWN(BEEP_UNITS));
+        keyerPush(SYMBOL_UP(1));
+    }
+}
+#endif
+
+#if defined(AUDIO_RX)
+/* Key edge detected in the receiver audio, decoded like a straight key */
+static void __not_in_flash_func(audioEdge)(uint32_t timestampUs, bool down) {
+    decoderEdge(timestampUs, down);
+}
+#endif
+
+/* Interrupt handler for IO Bank 0
+ * Runs from SRAM so a press never waits on an XIP cache miss. The
+ * debouncer masks the button while it bounces and calls buttonEdge()
+ * once per clean edge. C linkage so it overrides the weak alias in
+ * startup.c */
+extern "C" void __not_in_flash_func(ioIrqBank0)(void) {
+    uint32_t start = instrEnter();
+    debounceIrq();
+    instrExit(INSTR_BUTTON_EDGE, INSTR_BUTTON_ISR, start);
+}
+
+#if defined(USB_CDC)
+/* Longest status line, with the lateness figures in INSTRUMENT builds */
+#if defined(INSTRUMENT)
+#define STATUS_LINE_MAX 48
+#define LATENCY_LINE_MAX 56
+#define AUDIO_LINE_MAX 32
+#else
+#define STATUS_LINE_MAX 24
+#endif
+#define FAULT_LINE_MAX 40
+#define REPLY_LINE_MAX 5
+#define CUT_LINE_MAX 10
+
+static bool statusPending;
+#if defined(INSTRUMENT)
+static bool latencyPending;
+#endif
+#if defined(INSTRUMENT) && defined(AUDIO_RX)
+static bool audioPending;
+#endif
+static bool faultPending;
+static const char *commandReply;    /* OK or ERR line for the last command */
+static bool sendCut;                /* keyerSend() could not send it all */
+
+static void usbPutString(const char *text) {
+    while (*text != 0) {
+        usbCdcPutChar(*text++);
+    }
+}
+
+static void usbPutNumber(uint32_t value) {
+    char digits[10];
+    uint32_t count = 0;
+
+    /* Digits come out lowest first, hwDivide avoids a libgcc division */
+    do {
+        uint32_t quotient = hwDivide(value, 10);
+        digits[count++] = (char)('0' + value - quotient * 10);
+        value = quotient;
+    } while (value != 0);
+
+    while (count != 0) {
+        usbCdcPutChar(digits[--count]);
+    }
+}
+
+/* Eight hex digits, for addresses */
+static void usbPutHex(uint32_t value) {
+    for (uint32_t shift = 32; shift != 0; ) {
+        shift -= 4;
+        uint32_t digit = (value >> shift) & 0xf;
+        usbCdcPutChar((char)(digit < 10 ? '0' + digit : 'a' + digit - 10));
+    }
+}
+
+/* What reset the unit before this boot, see fault.h */
+static void usbPutFault(void) {
+    if (faultReport.cause == FAULT_TIMEOUT) {
+        usbPutString("FAULT WATCHDOG\r\n");
+        return;
+    }
+    usbPutString("FAULT EXC ");
+    usbPutNumber(faultReport.exception);
+    usbPutString(" PC ");
+    usbPutHex(faultReport.pc);
+    usbPutString(" LR ");
+    usbPutHex(faultReport.lr);
+    usbPutString("\r\n");
+}
+
+#if defined(INSTRUMENT)
+/* Label, then p99/max of one latency histogram
+ * Cycle counts stay below 2^24, so a figure is at most 17 characters */
+static void usbPutLatency(const char *label, enum instrId id) {
+    usbPutString(label);
+    usbPutNumber(instrPercentile(id, 99));
+    usbCdcPutChar('/');
+    usbPutNumber(instrumentStats.hist[id].max);
+}
+#endif
+
+/* Move outgoing data into the USB transmit packet, called after every
+ * wake up from the main loop:
+   1. The answer to a setting command, and SEND CUT once a message did
+      not fit the keyer
+   2. A status line once the host asked for it and a packet is free.
+      INSTRUMENT builds add the alarm lateness and send the edge
+      latencies in the next packet, with AUDIO_RX the measured cycles
+      of one audio block in the packet after. The fault that reset the
+      unit follows last
+   3. Decoded straight-key or audio text as far as the packet has room
+   4. Send whatever was written */
+static void usbService(void) {
+    if (commandReply != 0 && usbCdcWriteSpace() >= REPLY_LINE_MAX) {
+        usbPutString(commandReply);
+        commandReply = 0;
+    }
+    if (sendCut && usbCdcWriteSpace() >= CUT_LINE_MAX) {
+        usbPutString("SEND CUT\r\n");
+        sendCut = false;
+    }
+    if (usbCdcTakeStatusRequest()) {
+        statusPending = true;
+    }
+    if (statusPending && usbCdcWriteSpace() >= STATUS_LINE_MAX) {
+#if defined(DECODER_INPUT)
+        uint32_t wpm = decoderWpm();
+#else
+        uint32_t wpm = keyerWpm;
+#endif
+        usbPutString("WPM ");
+        usbPutNumber(wpm);
+        usbPutString(schedulerIdle() ? " TX IDLE\r\n" : " TX BUSY\r\n");
+#if defined(INSTRUMENT)
+        usbPutLatency("LATE ", INSTR_ALARM_LATE);
+        usbPutString(" US\r\n");
+        latencyPending = true;
+#endif
+        faultPending = faultReport.cause != FAULT_NONE;
+        statusPending = false;
+    }
+#if defined(INSTRUMENT)
+    else if (latencyPending && usbCdcWriteSpace() >= LATENCY_LINE_MAX) {
+        usbPutLatency("EDGE BTN ", INSTR_BUTTON_EDGE);
+        usbPutLatency(" ALARM ", INSTR_ALARM_EDGE);
+        usbPutString(" CYC\r\n");
+        latencyPending = false;
+#if defined(AUDIO_RX)
+        audioPending = true;
+#endif
+    }
+#endif
+#if defined(INSTRUMENT) && defined(AUDIO_RX)
+    else if (audioPending && usbCdcWriteSpace() >= AUDIO_LINE_MAX) {
+        usbPutLatency("AUDIO BLOCK ", INSTR_AUDIO_BLOCK);
+        usbPutString(" CYC\r\n");
+        audioPending = false;
+    }
+#endif
+    else if (faultPending && usbCdcWriteSpace() >= FAULT_LINE_MAX) {
+        usbPutFault();
+        faultPending = false;
+    }
+
+#if defined(DECODER_INPUT)
+    char c;
+    while (usbCdcWriteSpace() != 0 && decoderGetChar(&c)) {
+        usbCdcPutChar(c);
+    }
+#endif
+
+    usbCdcFlush();
+}
+#endif
+
+#if defined(BEACON_CHANNELS) || defined(PIO_BEACON) || defined(RTC_BEACON)
+/* Channel k's stored beacon text, or "VVV DE BCN<id>" with id A for
+ * channel 0 and so on. text has room for BEACON_TEXT_MAX + 1 */
+static void beaconText(uint32_t k, char *text) {
+    uint32_t length;
+    const char *stored = (const char *)storeGet(STORE_KEY_BEACON + k, &length);
+
+    if (stored != 0 && length <= BEACON_TEXT_MAX) {
+        for (uint32_t i = 0; i < length; i++) {
+            text[i] = stored[i];
+        }
+        text[length] = '\0';
+    } else {
+        for (uint32_t i = 0; i < sizeof BEACON_DEFAULT_TEXT; i++) {
+            text[i] = BEACON_DEFAULT_TEXT[i];
+        }
+        text[sizeof BEACON_DEFAULT_TEXT - 2] = (char)('A' + k);
+    }
+}
+#endif
+
+#if defined(BEACON_CHANNELS)
+static uint8_t beaconSymbols[BEACON_CHANNELS][BEACON_MAX_SYMBOLS];
+
+/* Encode each channel's beacon text and start all channels at the same
+ * instant. Stops them first, so a new text or speed restarts them all
+ * in step */
+static void beaconsLoad(void) {
+    channelsStop((1U << BEACON_CHANNELS) - 1);
+    for (uint32_t k = 0; k < BEACON_CHANNELS; k++) {
+        uint32_t mask = 1U << (BEACON_FIRST_PIN + k);   /* Set up by pinInit */
+        char text[BEACON_TEXT_MAX + 1];
+
+        beaconText(k, text);
+        uint32_t count = morseEncode(text, beaconSymbols[k], BEACON_MAX_SYMBOLS - 1);
+        beaconSymbols[k][count++] = SYMBOL_UP(BEACON_PAUSE_UNITS);
+
+        channelsConfigure(k, mask, morseDitUs(keyerWpm));
+        channelsLoad(k, beaconSymbols[k], count, true);
+    }
+    channelsStart((1U << BEACON_CHANNELS) - 1);
+}
+#endif
+
+/* Stored value of key if it is a uint32_t within min..max */
+static uint32_t storedSetting(uint32_t key, uint32_t fallback, uint32_t min, uint32_t max) {
+    uint32_t length;
+    const uint32_t *value = (const uint32_t *)storeGet(key, &length);
+
+    if (value == 0 || length != sizeof *value || *value < min || *value > max) {
+        return fallback;
+    }
+    return *value;
+}
+
+static void settingsLoad(void) {
+    storeInit();
+    keyerWpm = storedSetting(STORE_KEY_WPM, WPM, WPM_MIN, WPM_MAX);
+    keyerToneHz = storedSetting(STORE_KEY_TONE_HZ, TONE_HZ, TONE_HZ_MIN, TONE_HZ_MAX);
+}
+
+#if defined(PIO_BEACON)
+static bool beaconOn;
+
+/* Start or stop the beacon loop
+ * Only the first start encodes the text, later ones find it in the
+ * cache and start the DMA at once */
+static void pioBeaconToggle(void) {
+    if (beaconOn) {
+        toneDmaStop();
+        beaconOn = false;
+        return;
+    }
+    char text[BEACON_TEXT_MAX + 1];
+    beaconText(0, text);
+    beaconOn = toneCacheLoop(MESSAGE_BEACON, text, BEACON_PAUSE_UNITS);
+}
+#endif
+
+#if defined(RTC_BEACON)
+static volatile uint32_t beaconDue;     /* Bit k: text k waits to be sent */
+
+/* Schedule event, the main loop sends the text */
+static void rtcScheduled(uint32_t message) {
+    beaconDue |= 1U << message;
+}
+
+/* Send the due texts one at a time, each DMA completion wakes the core
+ * for the next. A running beacon loop holds them back until it stops */
+static void rtcBeaconSend(void) {
+    uint32_t due = beaconDue;
+
+    for (uint32_t k = 0; due != 0; k++, due >>= 1) {
+        if ((due & 1U) == 0) {
+            continue;
+        }
+        char text[BEACON_TEXT_MAX + 1];
+        beaconText(k, text);
+        if (!toneCacheSend(MESSAGE_BEACON + k, text)) {
+            return;
+        }
+        uint32_t primask = irqDisable();
+        beaconDue &= ~(1U << k);
+        irqRestore(primask);
+    }
+}
+#endif
+
+#if defined(HOST_COMMANDS)
+/* Put keyerWpm and keyerToneHz in effect
+ * KEYER_PIO: pioToneInit() resets PIO0 and makes every cached timeline
+ * a miss, so the DMA stops first. A message being sent is cut short, a
+ * running beacon loop starts over on the new timing
+ * Others: the scheduler keys the next symbol at the new speed and the
+ * PWM tone changes at once. Beacon channels restart in step. AUDIO_RX
+ * listens at the pitch it was started with until the next boot */
+static void keyerRetime(void) {
+#if defined(KEYER_PIO)
+    toneDmaStop();
+    uint32_t primask = irqDisable();
+    pioToneInit(SPEAKER_PIN, keyerToneHz, morseDitUs(keyerWpm));
+    irqRestore(primask);
+#if defined(PIO_BEACON)
+    if (beaconOn) {
+        beaconOn = false;
+        pioBeaconToggle();
+    }
+#endif
+#else
+    schedulerSetDit(morseDitUs(keyerWpm));
+#if defined(KEYER_PWM)
+    pwmToneSetFrequency(keyerToneHz);
+#endif
+#if defined(BEACON_CHANNELS)
+    beaconsLoad();
+#endif
+#endif
+}
+
+/* Beacon text k, length 0 for the default. Texts of channels this build
+ * does not send are kept for a build that does. The PIO keyer forgets
+ * the old encoding, with a running loop stopped first since it plays
+ * from the cache */
+static bool beaconSet(uint32_t k, const char *text, uint32_t length) {
+    if (k >= STORE_KEYS - STORE_KEY_BEACON || length > BEACON_TEXT_MAX ||
+        !storePut(STORE_KEY_BEACON + k, text, length)) {
+        return false;
+    }
+#if defined(PIO_BEACON)
+    bool restart = k == 0 && beaconOn;
+    if (restart) {
+        toneDmaStop();
+        beaconOn = false;
+    }
+#endif
+#if defined(KEYER_PIO)
+    toneCacheDrop(MESSAGE_BEACON + k);
+#endif
+#if defined(PIO_BEACON)
+    if (restart) {
+        pioBeaconToggle();
+    }
+#endif
+#if defined(BEACON_CHANNELS)
+    if (k < BEACON_CHANNELS) {
+        beaconsLoad();
+    }
+#endif
+    return true;
+}
+
+/* Store a setting from the host and put it in effect, false if it is
+ * malformed, out of range or the store is full
+ * The flash write masks interrupts for tens of milliseconds (store.h),
+ * keying stretches by as much */
+static bool commandApply(const struct command *command) {
+    switch (command->id) {
+    case COMMAND_WPM:
+        if (command->value < WPM_MIN || command->value > WPM_MAX ||
+            !storePut(STORE_KEY_WPM, &command->value, sizeof command->value)) {
+            return false;
+        }
+        keyerWpm = command->value;
+        keyerRetime();
+        return true;
+    case COMMAND_TONE:
+        if (command->value < TONE_HZ_MIN || command->value > TONE_HZ_MAX ||
+            !storePut(STORE_KEY_TONE_HZ, &command->value, sizeof command->value)) {
+            return false;
+        }
+        keyerToneHz = command->value;
+        keyerRetime();
+        return true;
+    case COMMAND_BEACON:
+        return beaconSet(command->value, command->text, command->length);
+    default:
+        return false;
+    }
+}
+
+/* Apply the command commandNextChar() stopped on, then let the input run
+ * again. The PIO keyer keys no host text, so the port is drained here
+ * and only its commands count */
+static void commandPoll(void) {
+    struct command command;
+
+#if defined(KEYER_PIO)
+    char c;
+    while (commandNextChar(&c)) {}
+#endif
+    while (commandTake(&command)) {
+        bool ok = commandApply(&command);
+#if defined(USB_CDC)
+        commandReply = ok ? "OK\r\n" : "ERR\r\n";
+#else
+        (void)ok;
+#endif
+#if defined(KEYER_PIO)
+        while (commandNextChar(&c)) {}
+#else
+        schedulerStart();   /* Reads on past the command */
+#endif
+    }
+}
+#endif
+
+#if defined(POWER_DORMANT)
+/* Nothing queued, sounding or being debounced and the button released
+ * (debounceIdle), so stopping the crystal loses nothing. Called with
+ * interrupts masked. The bench checks the same for the beep build */
+static bool keyerIdle(void) {
+    return schedulerIdle() && !morseBusy() && debounceIdle()
+#if defined(KEYER_PWM)
+           && pwmToneIdle()
+#endif
+#if defined(BUTTON_STRAIGHT_KEY)
+           && decoderIdle()
+#endif
+           ;
+}
+#endif
+
+int main(void) {
+    /* Report a fault that reset the unit, then move off the ring
+       oscillator before anything depends on timing */
+    faultInit();
+    clocksInit(CLOCK_PROFILE);
+    instrInit();    /* Cycle counter for INSTRUMENT builds */
+    settingsLoad(); /* Speed, tone and beacon texts from the flash store */
+
+    /* Release every block this build uses in one go, then set up all
+       pins from the table: the outputs start low, enabled together */
+    resetsRelease(INIT_RESETS);
+    regInitApply(pinInit.entry, pinInit.count);
+
+#if defined(KEYER_PIO)
+    /* Speaker is handed to PIO0, which generates the tone */
+    pioToneInit(SPEAKER_PIN, keyerToneHz, morseDitUs(keyerWpm));
+    toneDmaInit();
+#elif defined(KEYER_PWM)
+    /* Speaker is routed to its PWM slice and channel, the scheduler
+       keys the LED directly and the tone through its envelope */
+    pwmToneInit(SPEAKER_PIN, keyerToneHz, PWM_TONE_RAMP_US);
+    schedulerInit(ledPin::mask, morseDitUs(keyerWpm));
+    schedulerSetKeyHook(pwmToneKey);
+#else
+#if defined(KEYER_CORE1)
+    /* Start the symbol scheduler on core1 keying LED and speaker together */
+    keyerCoreStart(keyPins::mask, morseDitUs(keyerWpm));
+#else
+    /* Start the symbol scheduler keying LED and speaker together */
+    schedulerInit(keyPins::mask, morseDitUs(keyerWpm));
+#endif
+#endif
+
+    /* Setup button interrupt 
+       1. Start the decoder when the button is a straight key or audio
+          is decoded
+       2. Register the button with the debouncer, which enables both edge interrupts
+       3. Enable IO Bank 0 interrupt in NVIC (Nested Vectored Interrupt Controller) */
+#if defined(DECODER_INPUT)
+    decoderInit(keyerWpm);
+#endif
+    debounceInit();
+    debounceAdd(BUTTON_PIN, BUTTON_DEBOUNCE_US, BUTTON_ACTIVE_LOW != 0, buttonEdge);
+#if defined(BUTTON_IAMBIC)
+    iambicInit(IAMBIC_DIT_PIN, IAMBIC_DAH_PIN, PADDLE_DEBOUNCE_US, IAMBIC_MODE);
+#endif
+
+#if defined(UART_INPUT) && defined(KEYER_PIO)
+    /* Setting commands only, the main loop reads them after the UART
+       interrupt woke the core */
+    commandSource(uartRxGetChar);
+    uartRxInit(UART_BAUD, UART_FLOW, 0);
+#elif defined(UART_INPUT)
+    /* Key serial text as it arrives, the UART restarts the idle scheduler.
+       Setting commands are taken out on the way */
+    commandSource(uartRxGetChar);
+    morseStreamSource(commandNextChar);
+    schedulerSetSource(morseNextSourceSymbol);
+    uartRxInit(UART_BAUD, UART_FLOW, schedulerStart);
+#endif
+
+#if defined(USB_CDC)
+    /* Key host text as it arrives, USB restarts the idle scheduler.
+       Setting commands are taken out on the way */
+    commandSource(usbCdcGetChar);
+    morseStreamSource(commandNextChar);
+    schedulerSetSource(morseNextSourceSymbol);
+    usbCdcInit(schedulerStart);
+#endif
+    NVIC_ISER = 1U << IO_BANK0_IRQ;
+
+#if defined(AUDIO_RX)
+    /* Decode receiver audio at the sidetone pitch, the checks above
+       leave nothing for the call to fail on */
+    (void)audioRxInit(AUDIO_PIN, keyerToneHz, AUDIO_SAMPLE_HZ, audioEdge);
+#endif
+
+#if defined(BEACON_CHANNELS)
+    channelsInit();
+    beaconsLoad();      /* Independent beacons on their own pins */
+#endif
+#if defined(RTC_BEACON)
+    rtcScheduleInit(BEACON_CLOCK_START);
+    rtcScheduleStart(wakeSchedule, sizeof wakeSchedule / sizeof wakeSchedule[0],
+                     rtcScheduled);
+#endif
+
+#if defined(POWER_SLEEP)
+    /* Gate the clocks of everything this build does not use in sleep */
+    powerInit(SLEEP_KEYER_EN0 | SLEEP_INPUT_EN0 | SLEEP_RTC_EN0 | SLEEP_AUDIO_EN0,
+              SLEEP_INPUT_EN1);
+#endif
+
+    /* Startup test pattern, streamed by the encoder from the keyer's
+       interrupt while the core sleeps below */
+    bool sent = keyerSend(MESSAGE_STARTUP, STARTUP_MESSAGE);
+#if defined(USB_CDC)
+    sendCut = !sent;
+#else
+    (void)sent;
+#endif
+#if defined(FAULT_WATCHDOG)
+    watchdogStart(WATCHDOG_TIMEOUT_MS);
+#endif
+    
+    /* 1. CPU sleeps until interrupt occurs
+       2. wfi = Wait For Interrupt instruction
+       3. volatile prevents compiler optimization */
+    while (1) {
+#if defined(FAULT_WATCHDOG)
+        /* Masked from here to the restart, the waking interrupt is taken
+           with the watchdog running again */
+        uint32_t sleepMask = irqDisable();
+        watchdogPause();
+#endif
+#if defined(POWER_DORMANT)
+        /* 1. Check and stop with interrupts masked so no press slips in
+           2. The button level wakes the crystal, a press held from before
+              wakes it at once
+           3. The waking press raised no GPIO interrupt, resample it */
+        uint32_t primask = irqDisable();
+        if (keyerIdle()) {
+            powerDormant(BUTTON_PIN, BUTTON_ACTIVE_LOW ? GPIO_INT_LEVEL_LOW : GPIO_INT_LEVEL_HIGH,
+                         CLOCK_PROFILE);
+            debounceResample();
+        }
+        irqRestore(primask);
+#endif
+        __asm volatile("wfi");  
+#if defined(FAULT_WATCHDOG)
+        watchdogResume();
+        irqRestore(sleepMask);
+#endif
+#if defined(DECODER_INPUT)
+        decoderPoll();  /* Decode edges the interrupt collected */
+#endif
+#if defined(HOST_COMMANDS)
+        commandPoll();  /* Settings the host sent */
+#endif
+#if defined(USB_CDC)
+        usbService();   /* Status and decoded text to the host */
+#endif
+#if defined(PIO_BEACON)
+        if (beaconToggle) {
+            beaconToggle = false;
+            pioBeaconToggle();
+        }
+#endif
+#if defined(RTC_BEACON)
+        if (beaconDue != 0) {
+            rtcBeaconSend();
+        }
+#endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+/* UART Text Input
+ * The DMA channel writes with a 4 KB address ring, so write_addr wraps
+ * inside rxRing on its own. Data is handed out in chunks: each transfer
+ * count stops at the room left in the ring (minus the XOFF margin), and
+ * dmaIrq1 only runs when a chunk ends, so a full ring can never be
+ * overwritten. Bytes that arrive while the channel is stopped wait in
+ * the UART FIFO, where they also drive the hardware RTS.
+ *
+ * The PL011 RX timeout only fires while the RX FIFO holds data. The DMA
+ * empties the FIFO after every byte, so during reception it never fires
+ * and the end of a message is instead the ring running dry. At that
+ * point the consumer pauses the DMA request and arms the RX and RX
+ * timeout interrupts, which then signal the start of the next message */
+
+#include "rp2040.h"
+#include "clocks.h"
+#include "uartRx.h"
+#include "board.h"     /* UART_TX_PIN, UART_RX_PIN, UART_RTS_PIN */
+
+#define XON  0x11
+#define XOFF 0x13
+
+#define RING_MASK (UART_RX_RING_SIZE - 1)
+#define CH_MASK   (1U << UART_RX_DMA_CH)
+
+#define RX_DMA_CTRL (DMA_CTRL_EN | DMA_CTRL_DATA_SIZE_BYTE | DMA_CTRL_INCR_WRITE | \
+                     DMA_CTRL_RING_SIZE(UART_RX_RING_BITS) | DMA_CTRL_RING_SEL_WRITE | \
+                     DMA_CTRL_TREQ_SEL(DREQ_UART0_RX) | DMA_CTRL_CHAIN_TO(UART_RX_DMA_CH))
+
+/* Aligned to its size so the DMA write ring wraps at its end */
+static uint8_t rxRing[UART_RX_RING_SIZE] __attribute__((aligned(UART_RX_RING_SIZE)));
+
+static enum uartFlow flowMode;
+static uartRxWake wakeCallback;
+static volatile uint32_t rxWritten;     /* Bytes written by finished chunks */
+static volatile uint32_t chunkCount;    /* Length of the running chunk, 0 if stopped */
+static volatile uint32_t rxTail;        /* Bytes consumed */
+static volatile bool xoffSent;
+static volatile bool waiting;           /* DMA paused, RX interrupts armed */
+
+/* Bytes written so far, called with interrupts masked
+ * write_addr only moves once a byte has been written, so this never runs
+ * ahead of the data */
+static uint32_t __not_in_flash_func(rxHead)(void)
+{
+    if (chunkCount == 0 || (dma->ch[UART_RX_DMA_CH].al1_ctrl & DMA_CTRL_BUSY) == 0) {
+        return rxWritten + chunkCount;
+    }
+    uint32_t start = (uint32_t)&rxRing[rxWritten & RING_MASK];
+    return rxWritten + ((dma->ch[UART_RX_DMA_CH].write_addr - start) & RING_MASK);
+}
+
+static void __not_in_flash_func(sendFlow)(uint8_t c)
+{
+    if ((uart0->fr & UART_FR_TXFF) == 0) {
+        uart0->dr = c;
+    }
+}
+
+/* Start the next chunk once the previous one has finished
+ * Called with interrupts masked or from dmaIrq1 */
+static void __not_in_flash_func(armChunk)(void)
+{
+    rxWritten += chunkCount;
+    chunkCount = 0;
+
+    uint32_t room = UART_RX_RING_SIZE - (rxWritten - rxTail);
+    if (room == 0) {
+        return;     /* Full, restarted by uartRxGetChar() */
+    }
+
+    /* Stop at the XOFF threshold first so XOFF goes out in time */
+    uint32_t chunk = room;
+    if (flowMode == UART_FLOW_XONXOFF && !xoffSent && room > UART_RX_XOFF_MARGIN) {
+        chunk = room - UART_RX_XOFF_MARGIN;
+    }
+    chunkCount = chunk;
+    dma->ch[UART_RX_DMA_CH].al1_transfer_count_trig = chunk;
+}
+
+void uartRxInit(uint32_t baud, enum uartFlow flow, uartRxWake wake)
+{
+    RESETS_RESET &= ~(RESET_UART0 | RESET_DMA);
+    while ((RESETS_RESET_DONE & (RESET_UART0 | RESET_DMA)) != (RESET_UART0 | RESET_DMA)) {}
+
+    flowMode = flow;
+    wakeCallback = wake;
+    rxWritten = 0;
+    chunkCount = 0;
+    rxTail = 0;
+    xoffSent = false;
+    waiting = false;
+
+    /* Baud rate divisor:
+       1. 8 * clk_peri / baud is the divisor in 1/128 steps
+       2. The top bits are the integer part, the low 7 bits are rounded
+          to the 6-bit fraction
+       3. Writing lcr_h latches both */
+    uint32_t div = hwDivide(8 * clockGetHz(CLK_PERI), baud);
+    uint32_t ibrd = div >> 7;
+    uint32_t fbrd = ((div & 0x7f) + 1) >> 1;
+    if (ibrd == 0) {
+        ibrd = 1;
+        fbrd = 0;
+    } else if (ibrd >= 0xffff) {
+        ibrd = 0xffff;
+        fbrd = 0;
+    }
+    uart0->ibrd = ibrd;
+    uart0->fbrd = fbrd;
+    uart0->lcr_h = UART_LCR_H_WLEN_8 | UART_LCR_H_FEN;
+    uart0->ifls = 0;    /* RX interrupt at 1/8 full */
+    uart0->cr = UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE |
+                (flow == UART_FLOW_RTS ? UART_CR_RTSEN : 0);
+
+    io->gpio[UART_TX_PIN].ctrl = GPIO_FUNC_UART;
+    io->gpio[UART_RX_PIN].ctrl = GPIO_FUNC_UART;
+    pads->gpio[UART_RX_PIN] = PADS_GPIO_PUE | PADS_GPIO_IE;   /* Pull-up and input enable */
+    if (flow == UART_FLOW_RTS) {
+        io->gpio[UART_RTS_PIN].ctrl = GPIO_FUNC_UART;
+    }
+
+    /* Channel chains to itself, which means no chaining */
+    dma->ch[UART_RX_DMA_CH].read_addr = (uint32_t)&uart0->dr;
+    dma->ch[UART_RX_DMA_CH].write_addr = (uint32_t)rxRing;
+    dma->ch[UART_RX_DMA_CH].al1_ctrl = RX_DMA_CTRL;
+    dma->ints1 = CH_MASK;
+    dma->inte1 |= CH_MASK;
+    NVIC_ISER = (1U << DMA_IRQ_1) | (1U << UART0_IRQ);
+
+    uart0->dmacr = UART_DMACR_RXDMAE;
+    armChunk();
+}
+
+bool __not_in_flash_func(uartRxGetChar)(char *c)
+{
+    uint32_t primask = irqDisable();
+    uint32_t head = rxHead();
+
+    if (head == rxTail) {
+        /* Ring dry: pause the DMA request, then look once more so a byte
+           that was in flight is not stranded. After that any byte stays
+           in the FIFO and raises the RX or RX timeout interrupt */
+        uart0->dmacr = 0;
+        __asm volatile("dmb" ::: "memory");
+        head = rxHead();
+        if (head == rxTail) {
+            waiting = true;
+            uart0->icr = UART_INT_RX | UART_INT_RT;
+            uart0->imsc = UART_INT_RX | UART_INT_RT;
+            irqRestore(primask);
+            return false;
+        }
+        uart0->dmacr = UART_DMACR_RXDMAE;
+    }
+
+    *c = (char)rxRing[rxTail & RING_MASK];
+    rxTail = rxTail + 1;
+
+    if (xoffSent && head - rxTail <= UART_RX_XON_LEVEL) {
+        xoffSent = false;
+        sendFlow(XON);
+    }
+    if (chunkCount == 0) {
+        armChunk();     /* Ring was full, there is room again */
+    }
+
+    irqRestore(primask);
+    return true;
+}
+
+uint32_t uartRxPending(void)
+{
+    uint32_t primask = irqDisable();
+    uint32_t pending = rxHead() - rxTail;
+    irqRestore(primask);
+    return pending;
+}
+
+/* Interrupt handler for DMA_IRQ_1
+ * Overrides the weak alias in startup.c. Runs once per chunk: sends XOFF
+ * once the XOFF threshold is reached and starts the next chunk */
+void __not_in_flash_func(dmaIrq1)(void)
+{
+    dma->ints1 = CH_MASK;
+
+    uint32_t room = UART_RX_RING_SIZE - (rxWritten + chunkCount - rxTail);
+    if (flowMode == UART_FLOW_XONXOFF && !xoffSent && room <= UART_RX_XOFF_MARGIN) {
+        xoffSent = true;
+        sendFlow(XOFF);
+    }
+    armChunk();
+}
+
+/* Interrupt handler for UART0
+ * Overrides the weak alias in startup.c. Only armed while the ring is
+ * dry: resumes the DMA request and wakes the consumer */
+void __not_in_flash_func(uart0Irq)(void)
+{
+    uart0->imsc = 0;
+    uart0->icr = UART_INT_RX | UART_INT_RT;
+
+    if (waiting) {
+        waiting = false;
+        uart0->dmacr = UART_DMACR_RXDMAE;
+        if (wakeCallback != 0) {
+            wakeCallback();
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/* UART Text Input
+ * UART0 (GPIO0 TX, GPIO1 RX, GPIO3 RTS) receives text that is keyed as
+ * Morse. A DMA channel copies every byte into a 4 KB ring in SRAM with
+ * the channel's address wrapping, so reception costs no interrupt per
+ * byte. The keying engine pulls characters straight out of the ring
+ * through morseStreamSource(), which lets a host queue kilobytes ahead
+ * of transmission.
+ *
+ * Once the ring runs dry the port arms its RX and RX timeout interrupts
+ * and calls the wake callback on the first byte of the next message */
+
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DMA channel used for reception, channels 0 and 1 belong to toneDma.h */
+#define UART_RX_DMA_CH 2
+
+/* Ring size, a power of two that the ring is also aligned to */
+#define UART_RX_RING_BITS 12
+#define UART_RX_RING_SIZE (1U << UART_RX_RING_BITS)
+
+/* XON/XOFF thresholds in bytes
+ * XOFF is sent with UART_RX_XOFF_MARGIN bytes of room left, enough for a
+ * host that reacts late, and XON once the backlog drops to
+ * UART_RX_XON_LEVEL */
+#define UART_RX_XOFF_MARGIN 256
+#define UART_RX_XON_LEVEL (UART_RX_RING_SIZE / 2)
+
+/* Flow control towards the host */
+enum uartFlow {
+    UART_FLOW_NONE,
+    UART_FLOW_XONXOFF,  /* XOFF / XON characters on TX */
+    UART_FLOW_RTS       /* Hardware RTS, driven by the RX FIFO level */
+};
+
+/* Called when data arrives while the ring was empty */
+typedef void (*uartRxWake)(void);
+
+/* Configure UART0 for 8N1 at baud and start DMA reception
+ * Call after clocksInit(), flow selects how the host is throttled */
+void uartRxInit(uint32_t baud, enum uartFlow flow, uartRxWake wake);
+
+/* Take the next received character, returns false if the ring is empty
+ * Matches morseCharSource */
+bool uartRxGetChar(char *c);
+
+/* Bytes waiting in the ring */
+uint32_t uartRxPending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_RX_H */
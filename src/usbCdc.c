@@ -0,0 +1,493 @@
+/* USB CDC-ACM Device
+ * EP0 runs the control transfers needed for enumeration plus the three
+ * CDC-ACM class requests hosts send when opening a port. EP0 buffers
+ * carry descriptors and are filled packet by packet; the bulk endpoints
+ * keep their data in DPRAM for its whole life.
+ *
+ * usbctrlIrq does all controller work. usbCdcGetChar() runs from the
+ * keying engine's interrupt and the transmit side from thread mode */
+
+#include "rp2040.h"
+#include "usbCdc.h"
+
+#define USB_MANUFACTURER "RP2040"
+#define USB_PRODUCT      "Morse Keyer"
+
+/* Endpoint buffers, offsets into the DPRAM */
+#define EP1_IN_OFFSET   0x180
+#define EP2_OUT_OFFSET  0x1c0
+#define EP2_IN_OFFSET   0x200
+#define DPRAM(offset)   ((volatile uint8_t *)(USBCTRL_DPRAM_BASE + (offset)))
+
+#define EP0_SIZE 64
+#define EP2_SIZE 64
+
+/* buff_status bits */
+#define BUF_EP0_IN  (1U << 0)
+#define BUF_EP0_OUT (1U << 1)
+#define BUF_EP2_IN  (1U << 4)
+#define BUF_EP2_OUT (1U << 5)
+
+/* Standard and CDC class requests */
+#define REQ_GET_STATUS              0x00
+#define REQ_CLEAR_FEATURE           0x01
+#define REQ_SET_FEATURE             0x03
+#define REQ_SET_ADDRESS             0x05
+#define REQ_GET_DESCRIPTOR          0x06
+#define REQ_GET_CONFIGURATION       0x08
+#define REQ_SET_CONFIGURATION       0x09
+#define REQ_SET_INTERFACE           0x0b
+#define REQ_SET_LINE_CODING         0x20
+#define REQ_GET_LINE_CODING         0x21
+#define REQ_SET_CONTROL_LINE_STATE  0x22
+#define REQ_SEND_BREAK              0x23
+
+#define REQ_TYPE_MASK     0x60
+#define REQ_TYPE_STANDARD 0x00
+#define REQ_TYPE_CLASS    0x20
+
+#define DESC_DEVICE 1
+#define DESC_CONFIG 2
+#define DESC_STRING 3
+
+static const uint8_t deviceDescriptor[18] = {
+    18, DESC_DEVICE,
+    0x00, 0x02,                 /* USB 2.0 */
+    0xef, 0x02, 0x01,           /* Miscellaneous class with IAD */
+    EP0_SIZE,
+    USB_VID & 0xff, USB_VID >> 8,
+    USB_PID & 0xff, USB_PID >> 8,
+    0x00, 0x01,                 /* Device release 1.00 */
+    1, 2, 0,                    /* Manufacturer, product, no serial */
+    1                           /* One configuration */
+};
+
+static const uint8_t configDescriptor[75] = {
+    9, DESC_CONFIG, 75, 0, 2, 1, 0, 0x80, 50,  /* Bus powered, 100 mA */
+    /* Interface association: interfaces 0 and 1 form the CDC function */
+    8, 0x0b, 0, 2, 0x02, 0x02, 0x00, 0,
+    /* Interface 0: CDC communication, ACM, one endpoint */
+    9, 0x04, 0, 0, 1, 0x02, 0x02, 0x00, 0,
+    5, 0x24, 0x00, 0x20, 0x01,  /* Header, CDC 1.20 */
+    5, 0x24, 0x01, 0x00, 1,     /* Call management, data on interface 1 */
+    4, 0x24, 0x02, 0x02,        /* ACM, line coding and control line state */
+    5, 0x24, 0x06, 0, 1,        /* Union, master 0, slave 1 */
+    7, 0x05, 0x81, 0x03, 8, 0, 16,          /* EP1 IN interrupt */
+    /* Interface 1: CDC data, two bulk endpoints */
+    9, 0x04, 1, 0, 2, 0x0a, 0x00, 0x00, 0,
+    7, 0x05, 0x02, 0x02, EP2_SIZE, 0, 0,    /* EP2 OUT bulk */
+    7, 0x05, 0x82, 0x02, EP2_SIZE, 0, 0     /* EP2 IN bulk */
+};
+
+static const uint8_t languageDescriptor[4] = { 4, DESC_STRING, 0x09, 0x04 };
+static const uint8_t statusZero[2] = { 0, 0 };
+
+/* Control endpoint state */
+enum ep0Stage {
+    EP0_IDLE,
+    EP0_DATA_IN,        /* Sending descriptor or reply packets */
+    EP0_STATUS_OUT,     /* Waiting for the host's zero length status */
+    EP0_DATA_OUT,       /* Waiting for SET_LINE_CODING data */
+    EP0_STATUS_IN       /* Sending the zero length status */
+};
+
+static enum ep0Stage ep0Stage;
+static const uint8_t *ep0Data;
+static uint32_t ep0Remaining;
+static bool ep0Zlp;                 /* Reply shorter than asked, end with a short packet */
+static bool ep0Last;                /* Packet in flight ends the data stage */
+static bool ep0Pid;                 /* Next EP0 packet is DATA1 */
+static uint8_t pendingAddress;      /* Applied after the status stage */
+static uint8_t configuration;
+static uint8_t stringDescriptor[EP0_SIZE];
+static uint8_t lineCoding[7] = { 0x00, 0xc2, 0x01, 0x00, 0, 0, 8 };    /* 115200 8N1 */
+
+/* Bulk endpoint state */
+static usbCdcWake wakeCallback;
+static volatile bool configured;
+static bool rxPid;
+static bool txPid;
+static volatile uint32_t rxLength;  /* Bytes in the EP2 OUT buffer, 0 while armed */
+static uint32_t rxPos;              /* Next byte to consume */
+static volatile bool txBusy;        /* EP2 IN packet handed to the controller */
+static uint32_t txLength;
+static volatile bool statusRequested;
+
+/* Hand a buffer to the controller
+ * AVAILABLE must be written at least three clk_usb cycles after the rest
+ * of the buffer control word, which the nops cover for clk_sys up to
+ * 200 MHz */
+static void __not_in_flash_func(armBuffer)(volatile uint32_t *ctrl, uint32_t length,
+                                           bool data1, bool in)
+{
+    uint32_t value = length | (data1 ? USB_BUF_DATA1 : 0) | (in ? USB_BUF_FULL : 0);
+
+    *ctrl = value;
+    __asm volatile(".rept 12\n nop\n .endr");
+    *ctrl = value | USB_BUF_AVAILABLE;
+}
+
+static void ep0SendNext(void)
+{
+    uint32_t count = ep0Remaining > EP0_SIZE ? EP0_SIZE : ep0Remaining;
+
+    for (uint32_t i = 0; i < count; i++) {
+        usbDpram->ep0_buf[i] = ep0Data[i];
+    }
+    ep0Data += count;
+    ep0Remaining -= count;
+    ep0Last = count < EP0_SIZE || (ep0Remaining == 0 && !ep0Zlp);
+
+    armBuffer(&usbDpram->ep_buf_ctrl[0].in, count, ep0Pid, true);
+    ep0Pid = !ep0Pid;
+}
+
+/* Start an IN data stage, truncated to what the host asked for */
+static void ep0Start(const uint8_t *data, uint32_t length, uint32_t requested)
+{
+    if (length > requested) {
+        length = requested;
+    }
+    ep0Data = data;
+    ep0Remaining = length;
+    ep0Zlp = length < requested;
+    ep0Stage = EP0_DATA_IN;
+    ep0SendNext();
+}
+
+/* Acknowledge a request without data stage */
+static void ep0Status(void)
+{
+    ep0Stage = EP0_STATUS_IN;
+    armBuffer(&usbDpram->ep_buf_ctrl[0].in, 0, true, true);
+}
+
+/* Reject a request, cleared by the controller at the next SETUP */
+static void ep0Stall(void)
+{
+    ep0Stage = EP0_IDLE;
+    usb->ep_stall_arm = 3;
+    usbDpram->ep_buf_ctrl[0].in = USB_BUF_STALL;
+    usbDpram->ep_buf_ctrl[0].out = USB_BUF_STALL;
+}
+
+static void armRx(void)
+{
+    armBuffer(&usbDpram->ep_buf_ctrl[2].out, EP2_SIZE, rxPid, false);
+    rxPid = !rxPid;
+}
+
+static void configure(uint8_t value)
+{
+    uint32_t enable = value != 0 ? USB_EP_ENABLE : 0;
+
+    configuration = value;
+    configured = false;
+
+    usbDpram->ep_ctrl[0].in = enable | USB_EP_INTERRUPT_PER_BUFFER |
+                              USB_EP_TYPE_INTERRUPT | EP1_IN_OFFSET;
+    usbDpram->ep_ctrl[1].out = enable | USB_EP_INTERRUPT_PER_BUFFER |
+                               USB_EP_TYPE_BULK | EP2_OUT_OFFSET;
+    usbDpram->ep_ctrl[1].in = enable | USB_EP_INTERRUPT_PER_BUFFER |
+                              USB_EP_TYPE_BULK | EP2_IN_OFFSET;
+
+    rxPid = false;
+    txPid = false;
+    rxLength = 0;
+    rxPos = 0;
+    txLength = 0;
+    txBusy = false;
+
+    if (value != 0) {
+        armRx();
+        configured = true;
+    }
+}
+
+/* Build a string descriptor from ASCII */
+static uint32_t stringToDescriptor(const char *text)
+{
+    uint32_t length = 2;
+
+    while (*text != 0 && length < EP0_SIZE) {
+        stringDescriptor[length++] = (uint8_t)*text++;
+        stringDescriptor[length++] = 0;
+    }
+    stringDescriptor[0] = (uint8_t)length;
+    stringDescriptor[1] = DESC_STRING;
+    return length;
+}
+
+static void getDescriptor(uint16_t value, uint16_t requested)
+{
+    switch (value >> 8) {
+    case DESC_DEVICE:
+        ep0Start(deviceDescriptor, sizeof(deviceDescriptor), requested);
+        break;
+    case DESC_CONFIG:
+        ep0Start(configDescriptor, sizeof(configDescriptor), requested);
+        break;
+    case DESC_STRING:
+        switch (value & 0xff) {
+        case 0:
+            ep0Start(languageDescriptor, sizeof(languageDescriptor), requested);
+            break;
+        case 1:
+            ep0Start(stringDescriptor, stringToDescriptor(USB_MANUFACTURER), requested);
+            break;
+        case 2:
+            ep0Start(stringDescriptor, stringToDescriptor(USB_PRODUCT), requested);
+            break;
+        default:
+            ep0Stall();
+            break;
+        }
+        break;
+    default:
+        ep0Stall();
+        break;
+    }
+}
+
+static void handleSetup(void)
+{
+    volatile const uint8_t *setup = usbDpram->setup;
+    uint8_t type = setup[0];
+    uint8_t request = setup[1];
+    uint16_t value = (uint16_t)(setup[2] | (setup[3] << 8));
+    uint16_t length = (uint16_t)(setup[6] | (setup[7] << 8));
+
+    /* The first packet after SETUP is always DATA1 */
+    ep0Pid = true;
+
+    if ((type & REQ_TYPE_MASK) == REQ_TYPE_STANDARD) {
+        switch (request) {
+        case REQ_GET_STATUS:
+            ep0Start(statusZero, sizeof(statusZero), length);
+            break;
+        case REQ_CLEAR_FEATURE:
+        case REQ_SET_FEATURE:
+        case REQ_SET_INTERFACE:
+            ep0Status();
+            break;
+        case REQ_SET_ADDRESS:
+            pendingAddress = value & 0x7f;
+            ep0Status();
+            break;
+        case REQ_GET_DESCRIPTOR:
+            getDescriptor(value, length);
+            break;
+        case REQ_GET_CONFIGURATION:
+            ep0Start(&configuration, 1, length);
+            break;
+        case REQ_SET_CONFIGURATION:
+            configure((uint8_t)value);
+            ep0Status();
+            break;
+        default:
+            ep0Stall();
+            break;
+        }
+    } else if ((type & REQ_TYPE_MASK) == REQ_TYPE_CLASS) {
+        switch (request) {
+        case REQ_SET_LINE_CODING:
+            ep0Stage = EP0_DATA_OUT;
+            armBuffer(&usbDpram->ep_buf_ctrl[0].out, EP0_SIZE, true, false);
+            break;
+        case REQ_GET_LINE_CODING:
+            ep0Start(lineCoding, sizeof(lineCoding), length);
+            break;
+        case REQ_SET_CONTROL_LINE_STATE:
+        case REQ_SEND_BREAK:
+            ep0Status();
+            break;
+        default:
+            ep0Stall();
+            break;
+        }
+    } else {
+        ep0Stall();
+    }
+}
+
+static void ep0InDone(void)
+{
+    if (ep0Stage == EP0_DATA_IN) {
+        if (ep0Last) {
+            ep0Stage = EP0_STATUS_OUT;
+            armBuffer(&usbDpram->ep_buf_ctrl[0].out, 0, true, false);
+        } else {
+            ep0SendNext();
+        }
+    } else if (ep0Stage == EP0_STATUS_IN) {
+        /* The new address only applies once the status stage is done */
+        if (pendingAddress != 0) {
+            usb->addr_endp = pendingAddress;
+            pendingAddress = 0;
+        }
+        ep0Stage = EP0_IDLE;
+    }
+}
+
+static void ep0OutDone(void)
+{
+    if (ep0Stage == EP0_DATA_OUT) {
+        for (uint32_t i = 0; i < sizeof(lineCoding); i++) {
+            lineCoding[i] = usbDpram->ep0_buf[i];
+        }
+        ep0Status();
+    } else {
+        ep0Stage = EP0_IDLE;
+    }
+}
+
+/* A bulk OUT packet landed in DPRAM, leave it there for the consumer */
+static void __not_in_flash_func(rxDone)(void)
+{
+    uint32_t length = usbDpram->ep_buf_ctrl[2].out & USB_BUF_LEN_MASK;
+    volatile const uint8_t *data = DPRAM(EP2_OUT_OFFSET);
+
+    if (length == 0) {
+        armRx();
+        return;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] == USB_CDC_STATUS_REQUEST) {
+            statusRequested = true;
+        }
+    }
+
+    rxPos = 0;
+    rxLength = length;
+    if (wakeCallback != 0) {
+        wakeCallback();
+    }
+}
+
+void usbCdcInit(usbCdcWake wake)
+{
+    RESETS_RESET |= RESET_USBCTRL;
+    RESETS_RESET &= ~RESET_USBCTRL;
+    while ((RESETS_RESET_DONE & RESET_USBCTRL) == 0) {}
+
+    volatile uint32_t *dpram = (volatile uint32_t *)USBCTRL_DPRAM_BASE;
+    for (uint32_t i = 0; i < sizeof(struct usb_dpram) / 4; i++) {
+        dpram[i] = 0;
+    }
+
+    wakeCallback = wake;
+    configured = false;
+    ep0Stage = EP0_IDLE;
+
+    /* Device mode on the internal PHY:
+       1. Connect the controller to the PHY and allow software connect
+       2. No VBUS pin, report VBUS as always present
+       3. Interrupt per EP0 buffer, for buffers, bus reset and SETUP
+       4. Enable the pull-up, the host now sees the device */
+    usb->muxing = USB_MUXING_TO_PHY | USB_MUXING_SOFTCON;
+    usb->pwr = USB_PWR_VBUS_DETECT | USB_PWR_VBUS_DETECT_OVERRIDE_EN;
+    usb->main_ctrl = USB_MAIN_CTRL_CONTROLLER_EN;
+    usb->sie_ctrl = USB_SIE_CTRL_EP0_INT_1BUF;
+    usb->inte = USB_INT_BUFF_STATUS | USB_INT_BUS_RESET | USB_INT_SETUP_REQ;
+    NVIC_ISER = 1U << USBCTRL_IRQ;
+    usb->sie_ctrl = USB_SIE_CTRL_EP0_INT_1BUF | USB_SIE_CTRL_PULLUP_EN;
+}
+
+bool usbCdcConfigured(void)
+{
+    return configured;
+}
+
+bool __not_in_flash_func(usbCdcGetChar)(char *c)
+{
+    uint32_t primask = irqDisable();
+    bool got = false;
+
+    if (rxLength != 0) {
+        *c = (char)DPRAM(EP2_OUT_OFFSET)[rxPos++];
+        got = true;
+        if (rxPos == rxLength) {
+            /* Packet consumed, only now may the host send the next one */
+            rxLength = 0;
+            armRx();
+        }
+    }
+
+    irqRestore(primask);
+    return got;
+}
+
+uint32_t usbCdcWriteSpace(void)
+{
+    return (configured && !txBusy) ? EP2_SIZE - txLength : 0;
+}
+
+bool usbCdcPutChar(char c)
+{
+    if (usbCdcWriteSpace() == 0) {
+        return false;
+    }
+    DPRAM(EP2_IN_OFFSET)[txLength++] = (uint8_t)c;
+    return true;
+}
+
+void usbCdcFlush(void)
+{
+    uint32_t primask = irqDisable();
+
+    if (configured && !txBusy && txLength != 0) {
+        txBusy = true;
+        armBuffer(&usbDpram->ep_buf_ctrl[2].in, txLength, txPid, true);
+        txPid = !txPid;
+        txLength = 0;
+    }
+
+    irqRestore(primask);
+}
+
+bool usbCdcTakeStatusRequest(void)
+{
+    uint32_t primask = irqDisable();
+    bool requested = statusRequested;
+    statusRequested = false;
+    irqRestore(primask);
+    return requested;
+}
+
+/* Interrupt handler for USBCTRL
+ * Overrides the weak alias in startup.c */
+void __not_in_flash_func(usbctrlIrq)(void)
+{
+    uint32_t status = usb->ints;
+
+    if (status & USB_INT_SETUP_REQ) {
+        usb->sie_status = USB_SIE_STATUS_SETUP_REC;
+        handleSetup();
+    }
+
+    if (status & USB_INT_BUFF_STATUS) {
+        uint32_t buffers = usb->buff_status;
+        usb->buff_status = buffers;
+
+        if (buffers & BUF_EP0_IN) {
+            ep0InDone();
+        }
+        if (buffers & BUF_EP0_OUT) {
+            ep0OutDone();
+        }
+        if (buffers & BUF_EP2_OUT) {
+            rxDone();
+        }
+        if (buffers & BUF_EP2_IN) {
+            txBusy = false;
+        }
+    }
+
+    if (status & USB_INT_BUS_RESET) {
+        usb->sie_status = USB_SIE_STATUS_BUS_RESET;
+        usb->addr_endp = 0;
+        pendingAddress = 0;
+        ep0Stage = EP0_IDLE;
+        configure(0);
+    }
+}
@@ -0,0 +1,67 @@
+/* USB CDC-ACM Device
+ * A minimal full-speed device with one CDC-ACM function: EP0 control,
+ * EP1 IN notification (never sent) and EP2 OUT/IN bulk data. The host
+ * sees a serial port and needs no driver.
+ *
+ * Received bytes are read in place from the EP2 OUT buffer in the USB
+ * DPRAM and the buffer is only handed back to the controller once every
+ * byte has been consumed. Until then the host is NAKed, which throttles
+ * it without any buffering here. Transmitted bytes are written straight
+ * into the EP2 IN buffer.
+ *
+ * Needs clk_usb at 48 MHz, so not the CLOCK_PROFILE_XOSC profile */
+
+#ifndef USB_CDC_H
+#define USB_CDC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Device identity, override for production */
+#ifndef USB_VID
+#define USB_VID 0x2e8a
+#endif
+#ifndef USB_PID
+#define USB_PID 0x000a
+#endif
+
+/* Host to device byte that requests a status report (ASCII ENQ)
+ * Has no Morse code, so the encoder skips it */
+#define USB_CDC_STATUS_REQUEST 0x05
+
+/* Called when a packet arrives while all earlier data was consumed */
+typedef void (*usbCdcWake)(void);
+
+/* Release the controller from reset and connect to the bus
+ * Call after clocksInit() */
+void usbCdcInit(usbCdcWake wake);
+
+/* True once the host has selected the configuration */
+bool usbCdcConfigured(void);
+
+/* Take the next received byte, returns false if none is waiting
+ * Matches morseCharSource. Single consumer */
+bool usbCdcGetChar(char *c);
+
+/* Room left in the transmit packet, 0 while the previous one is still
+ * being sent or the host has not configured the device */
+uint32_t usbCdcWriteSpace(void);
+
+/* Append one byte to the transmit packet, returns false if it is full */
+bool usbCdcPutChar(char c);
+
+/* Send the transmit packet if it holds any bytes */
+void usbCdcFlush(void);
+
+/* True once after the host sent USB_CDC_STATUS_REQUEST */
+bool usbCdcTakeStatusRequest(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_CDC_H */
@@ -0,0 +1,48 @@
+/* Vector Table in SRAM
+ * VTOR keeps bits 31:8 on the M0+, so the copy is aligned to 256 bytes,
+ * the 192-byte table rounded up to a power of two. It lives in .bss,
+ * which resetHandler has cleared by the time it is filled.
+ *
+ * The core reads an entry as one word, so a handler is swapped with one
+ * store. The barrier makes it visible before the caller goes on to
+ * enable the interrupt it serves */
+
+#include "rp2040.h"
+#include "vector.h"
+
+#if defined(VECTOR_TABLE_RAM)
+
+#define VECTOR_ALIGN 256
+
+typedef char vectorTableFitsAlign[VECTOR_COUNT * 4 <= VECTOR_ALIGN ? 1 : -1];
+
+/* Flash table, startup.c */
+extern const vectorHandler vector[VECTOR_COUNT];
+
+static vectorHandler ramVector[VECTOR_COUNT] __attribute__((aligned(VECTOR_ALIGN)));
+
+void vectorRelocate(void)
+{
+    for (uint32_t i = 0; i < VECTOR_COUNT; i++) {
+        ramVector[i] = vector[i];
+    }
+    __asm volatile("dsb" ::: "memory");
+    M0PLUS_VTOR = (uint32_t)ramVector;
+    __asm volatile("dsb\n isb" ::: "memory");
+}
+
+vectorHandler vectorInstall(uint32_t index, vectorHandler handler)
+{
+    if (index < VECTOR_NMI || index >= VECTOR_COUNT) {
+        return 0;
+    }
+
+    uint32_t primask = irqDisable();
+    vectorHandler previous = ramVector[index];
+    ramVector[index] = handler;
+    __asm volatile("dsb" ::: "memory");
+    irqRestore(primask);
+    return previous;
+}
+
+#endif
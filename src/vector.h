@@ -0,0 +1,55 @@
+/* Vector Table in SRAM
+ * Opt-in build (VECTORS=ram in the Makefile). resetHandler copies the
+ * flash table of startup.c into an aligned SRAM copy and points VTOR at
+ * it, before any interrupt is enabled:
+ * 1. Exception entry fetches the handler address from SRAM, so it never
+ *    waits on an XIP cache miss, e.g. after a flash store write
+ * 2. Handlers can be swapped at run time with vectorInstall(), so one
+ *    image can change what an interrupt does without a relink
+ * 3. A fault taken while XIP is off still reaches defaultHandler
+ *
+ * Both cores use the copy: multicoreLaunch() hands core1 the VTOR of
+ * core0, so an installed handler serves the interrupt on either core.
+ * Which core takes it is still up to each core's NVIC */
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp2040.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entries of the table in startup.c: 16 core exceptions, 32 interrupts */
+#define VECTOR_COUNT 48
+
+/* Table index of interrupt n, e.g. VECTOR_IRQ(IO_BANK0_IRQ) */
+#define VECTOR_IRQ(n) (16 + (n))
+#define VECTOR_NMI 2
+#define VECTOR_HARDFAULT 3
+
+typedef void (*vectorHandler)(void);
+
+#if defined(VECTOR_TABLE_RAM)
+
+/* Copy the table and move VTOR to the copy, called by resetHandler once
+ * .bss is cleared */
+void vectorRelocate(void);
+
+/* Make handler serve table entry index from the next exception on and
+ * return the one it replaces, to restore or chain to it. Entries 0 and 1
+ * (stack pointer and reset) are only read at reset and cannot be set,
+ * nor can indices from VECTOR_COUNT on: both return 0 */
+vectorHandler vectorInstall(uint32_t index, vectorHandler handler);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VECTOR_H */